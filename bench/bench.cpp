@@ -0,0 +1,363 @@
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "machine.h"
+#include "trace_reader.h"
+
+// Benchmarks for the simulator's hot paths. Every benchmark is run a few
+// times and the fastest run is reported, throughput is in accesses (or
+// records) per second so results from different --ops are comparable.
+
+struct BenchResult
+{
+  std::string name;
+  size_t ops;
+  double seconds;
+};
+
+struct BenchOptions
+{
+  size_t ops = 200000;
+  int reps = 3;
+  std::string filter;
+  std::string json_path;
+};
+
+// xorshift64*, deterministic so every run sees the same accesses
+struct Rng
+{
+  uint64_t state;
+  explicit Rng(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+  uint64_t next()
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+  }
+  size_t below(size_t n) { return next() % n; }
+};
+
+struct Access
+{
+  int proc;
+  bool is_write;
+  size_t addr;
+  int node_id;
+};
+
+std::vector<BenchResult> results;
+
+// setup runs outside of the timed region before every repetition
+void runBench(const BenchOptions &opts, const std::string &name, size_t ops, const std::function<void()> &setup,
+              const std::function<void()> &body)
+{
+  if (opts.filter != "" && name.find(opts.filter) == std::string::npos)
+    return;
+
+  double best = 0;
+  for (int rep = 0; rep < opts.reps; ++rep)
+  {
+    setup();
+    auto start = std::chrono::steady_clock::now();
+    body();
+    double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (rep == 0 || t < best)
+      best = t;
+  }
+
+  results.push_back({name, ops, best});
+  std::cout << std::left << std::setw(40) << name << std::right << std::setw(12) << ops << std::setw(12)
+            << std::fixed << std::setprecision(4) << best << "s" << std::setw(16) << std::setprecision(0)
+            << ops / best << " ops/s" << std::endl;
+}
+
+std::string geometryName(int s, int E, int b)
+{
+  return "s" + std::to_string(s) + "E" + std::to_string(E) + "b" + std::to_string(b);
+}
+
+void simulate(std::vector<NUMANode *> &nodes, const std::vector<Access> &accesses, int procs)
+{
+  int numa_nodes = nodes.size();
+  for (const Access &a : accesses)
+  {
+    int proc_node = procToNode(a.proc, procs, numa_nodes);
+    if (a.is_write)
+      nodes[proc_node]->cacheWrite(a.proc, a.addr, a.node_id);
+    else
+      nodes[proc_node]->cacheRead(a.proc, a.addr, a.node_id);
+  }
+}
+
+void deleteMachine(std::vector<NUMANode *> &nodes)
+{
+  for (NUMANode *node : nodes)
+    delete node;
+  nodes.clear();
+}
+
+std::string toTrace(const std::vector<Access> &accesses, bool with_ip)
+{
+  std::ostringstream out;
+  out << std::hex;
+  for (const Access &a : accesses)
+  {
+    out << std::dec << a.proc << (a.is_write ? " W 0x" : " R 0x") << std::hex << a.addr << std::dec << " "
+        << a.node_id;
+    if (with_ip)
+      out << " ip=0x" << std::hex << 0x400000 + (a.addr & 0xfff) << std::dec;
+    out << "\n";
+  }
+  out << "#eof\n";
+  return out.str();
+}
+
+// uniform accesses over a shared region, homed by page
+std::vector<Access> uniformAccesses(size_t ops, int procs, int numa_nodes, size_t region, double write_ratio)
+{
+  Rng rng(ops + procs);
+  std::vector<Access> accesses(ops);
+  for (Access &a : accesses)
+  {
+    a.proc = rng.below(procs);
+    a.addr = 0x10000000 + (rng.below(region) & ~(size_t)7);
+    a.is_write = rng.below(1000) < write_ratio * 1000;
+    a.node_id = (a.addr >> 12) % numa_nodes;
+  }
+  return accesses;
+}
+
+// everyone spins on one lock word and a random proc takes it now and then
+std::vector<Access> lockAccesses(size_t ops, int procs, int numa_nodes)
+{
+  Rng rng(ops * 31 + procs);
+  std::vector<Access> accesses(ops);
+  for (Access &a : accesses)
+  {
+    a.proc = rng.below(procs);
+    a.is_write = rng.below(100) < 5;
+    a.addr = rng.below(100) < 80 ? 0x20000000 : 0x20001000 + a.proc * 64;
+    a.node_id = (a.addr >> 12) % numa_nodes;
+  }
+  return accesses;
+}
+
+void benchParse(const BenchOptions &opts)
+{
+  for (bool with_ip : {false, true})
+  {
+    std::string trace = toTrace(uniformAccesses(opts.ops, 8, 4, 1 << 20, 0.3), with_ip);
+    std::istringstream in;
+    size_t records = 0;
+    runBench(
+        opts, with_ip ? "parse/ip" : "parse/plain", opts.ops,
+        [&]()
+        {
+          in.clear();
+          in.str(trace);
+          records = 0;
+        },
+        [&]()
+        {
+          TraceReader reader(in);
+          TraceRecord record;
+          while (reader.next(record))
+            records += record.proc;
+        });
+  }
+}
+
+void benchCache(const BenchOptions &opts, int s, int E, int b)
+{
+  std::vector<NUMANode *> nodes;
+  size_t lines = ((size_t)1 << s) * E;
+  size_t line_size = (size_t)1 << b;
+
+  // a working set that fits, so every access after warm-up is a hit
+  std::vector<Access> hits(opts.ops);
+  for (size_t i = 0; i < hits.size(); ++i)
+    hits[i] = {0, i % 4 == 0, 0x10000000 + (i % lines) * line_size, 0};
+  runBench(
+      opts, "cache_hit/" + geometryName(s, E, b), opts.ops,
+      [&]()
+      {
+        deleteMachine(nodes);
+        nodes = NewMachine(1, 1, s, E, b, Protocol::MOESI);
+        simulate(nodes, std::vector<Access>(hits.begin(), hits.begin() + std::min(lines, hits.size())), 1);
+      },
+      [&]()
+      { simulate(nodes, hits, 1); });
+
+  // a stream four times the cache size, every access misses and evicts
+  std::vector<Access> misses(opts.ops);
+  for (size_t i = 0; i < misses.size(); ++i)
+    misses[i] = {0, i % 4 == 0, 0x10000000 + (i % (4 * lines)) * line_size, 0};
+  runBench(
+      opts, "cache_miss/" + geometryName(s, E, b), opts.ops,
+      [&]()
+      {
+        deleteMachine(nodes);
+        nodes = NewMachine(1, 1, s, E, b, Protocol::MOESI);
+      },
+      [&]()
+      { simulate(nodes, misses, 1); });
+  deleteMachine(nodes);
+}
+
+void benchDirectory(const BenchOptions &opts, int procs)
+{
+  int numa_nodes = std::min(procs, 4);
+  std::vector<NUMANode *> nodes;
+  std::string suffix = "/p" + std::to_string(procs);
+
+  // read misses on a region larger than the caches, every access is a BusRd
+  std::vector<Access> reads(opts.ops);
+  for (size_t i = 0; i < reads.size(); ++i)
+  {
+    size_t addr = 0x10000000 + ((i * 7919) % (1 << 16)) * 64;
+    reads[i] = {(int)(i % procs), false, addr, (int)((addr >> 12) % numa_nodes)};
+  }
+  runBench(
+      opts, "directory_busrd" + suffix, opts.ops,
+      [&]()
+      {
+        deleteMachine(nodes);
+        nodes = NewMachine(procs, numa_nodes, 6, 8, 6, Protocol::MOESI);
+      },
+      [&]()
+      { simulate(nodes, reads, procs); });
+
+  // procs take turns writing a few lines, every access is a BusRdX that
+  // fetches and invalidates the previous owner
+  std::vector<Access> writes(opts.ops);
+  for (size_t i = 0; i < writes.size(); ++i)
+  {
+    size_t addr = 0x10000000 + (i % 16) * 64;
+    writes[i] = {(int)((i / 16) % procs), true, addr, (int)((addr >> 12) % numa_nodes)};
+  }
+  runBench(
+      opts, "directory_busrdx" + suffix, opts.ops,
+      [&]()
+      {
+        deleteMachine(nodes);
+        nodes = NewMachine(procs, numa_nodes, 6, 8, 6, Protocol::MOESI);
+      },
+      [&]()
+      { simulate(nodes, writes, procs); });
+  deleteMachine(nodes);
+}
+
+// parse and simulate a whole synthetic trace, like sim.out does
+void benchEndToEnd(const BenchOptions &opts, const std::string &pattern, int procs, int s, int E, int b)
+{
+  int numa_nodes = std::min(procs, 4);
+  std::vector<Access> accesses = pattern == "lock" ? lockAccesses(opts.ops, procs, numa_nodes)
+                                                   : uniformAccesses(opts.ops, procs, numa_nodes, 1 << 20, 0.3);
+  std::string trace = toTrace(accesses, true);
+  std::vector<NUMANode *> nodes;
+  std::istringstream in;
+
+  runBench(
+      opts, "e2e/" + pattern + "/p" + std::to_string(procs) + "/" + geometryName(s, E, b), opts.ops,
+      [&]()
+      {
+        deleteMachine(nodes);
+        nodes = NewMachine(procs, numa_nodes, s, E, b, Protocol::MOESI);
+        in.clear();
+        in.str(trace);
+      },
+      [&]()
+      {
+        TraceReader reader(in);
+        TraceRecord record;
+        while (reader.next(record))
+        {
+          int proc_node = procToNode(record.proc, procs, numa_nodes);
+          if (record.rw == 'R')
+            nodes[proc_node]->cacheRead(record.proc, record.addr, record.node_id);
+          else
+            nodes[proc_node]->cacheWrite(record.proc, record.addr, record.node_id);
+        }
+      });
+  deleteMachine(nodes);
+}
+
+void writeJson(const BenchOptions &opts)
+{
+  std::ofstream out(opts.json_path);
+  if (!out.is_open())
+  {
+    std::cerr << "Cannot open " << opts.json_path << "\n";
+    exit(1);
+  }
+  out << "{\"ops\":" << opts.ops << ",\"reps\":" << opts.reps << ",\"benchmarks\":[";
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const BenchResult &r = results[i];
+    out << (i ? "," : "") << "\n{\"name\":\"" << r.name << "\",\"ops\":" << r.ops << ",\"seconds\":"
+        << std::setprecision(9) << r.seconds << ",\"ops_per_sec\":" << std::fixed << std::setprecision(1)
+        << r.ops / r.seconds << std::defaultfloat << "}";
+  }
+  out << "\n]}\n";
+}
+
+int main(int argc, char **argv)
+{
+  std::string usage;
+  usage += "-n <ops>: accesses per benchmark, default is 200000\n";
+  usage += "-r <reps>: repetitions per benchmark, the fastest is reported, default is 3\n";
+  usage += "-f <filter>: only run benchmarks whose name contains filter\n";
+  usage += "-j <file>: also write the results as json, for util/bench-compare.py\n";
+  usage += "-h: help\n";
+
+  BenchOptions opts;
+  int opt;
+  while ((opt = getopt(argc, argv, "hn:r:f:j:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n':
+      opts.ops = strtoull(optarg, nullptr, 10);
+      break;
+    case 'r':
+      opts.reps = std::max(1, atoi(optarg));
+      break;
+    case 'f':
+      opts.filter = std::string(optarg);
+      break;
+    case 'j':
+      opts.json_path = std::string(optarg);
+      break;
+    case 'h':
+      std::cout << usage;
+      return 0;
+    default:
+      std::cerr << usage;
+      return 1;
+    }
+  }
+
+  benchParse(opts);
+
+  for (auto [s, E, b] : {std::tuple{6, 8, 6}, std::tuple{10, 16, 6}, std::tuple{12, 4, 7}})
+    benchCache(opts, s, E, b);
+
+  for (int procs : {4, 16, 32})
+    benchDirectory(opts, procs);
+
+  for (std::string pattern : {"uniform", "lock"})
+    for (int procs : {1, 4, 16, 32})
+      benchEndToEnd(opts, pattern, procs, 6, 8, 6);
+  benchEndToEnd(opts, "uniform", 16, 10, 16, 6);
+
+  if (opts.json_path != "")
+    writeJson(opts);
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include "lock_common.h"
+
+struct alignas(CACHELINE_SIZE) clh_node
+{
+  atomic<bool> locked;
+};
+
+// one node per thread and the initial head, nodes move between threads
+clh_node NODES[MAX_THREADS + 1];
+
+// Craig, Landin and Hagersten: an implicit queue, each waiter spins on its
+// predecessor's node and takes that node over for its next acquisition
+struct spinlock
+{
+  alignas(CACHELINE_SIZE) atomic<clh_node *> tail;
+  spinlock()
+  {
+    clh_node *head = &NODES[MAX_THREADS];
+    head->locked.store(false);
+    tail.store(head);
+  }
+  // returns the node to use next time
+  clh_node *lock(clh_node *me)
+  {
+    me->locked.store(true);
+    clh_node *pred = tail.exchange(me);
+    while (pred->locked.load())
+      ;
+    return pred;
+  }
+  void unlock(clh_node *me) { me->locked.store(false); }
+} LOCK;
+
+workload W;
+
+void incr(int tid)
+{
+  clh_node *me = &NODES[tid];
+  for (int i = 0; i < W.iterations; i++)
+  {
+    clh_node *pred = LOCK.lock(me);
+    critical_section(W);
+    LOCK.unlock(me);
+    me = pred;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  W = parse_args(argc, argv, false, "clh_lock");
+  run_threads(W, incr);
+  return 0;
+}
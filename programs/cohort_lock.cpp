@@ -0,0 +1,25 @@
+#include "lock_common.h"
+
+// C-BO-MCS, see cohort_lock in lock_common.h
+cohort_lock LOCK;
+
+workload W;
+
+void incr(int tid)
+{
+  int cluster = cluster_of(tid, W);
+  mcs_node me;
+  for (int i = 0; i < W.iterations; i++)
+  {
+    LOCK.lock(&me, cluster);
+    critical_section(W);
+    LOCK.unlock(&me, cluster);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  W = parse_args(argc, argv, true, "cohort_lock");
+  run_threads(W, incr);
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "lock_common.h"
+
+// qnode state: the cluster of its owner and two flags in one word, so the
+// waiter sees them change together
+const unsigned int TAIL_WHEN_SPLICED = 0x80000000;
+const unsigned int SUCCESSOR_MUST_WAIT = 0x40000000;
+const unsigned int CLUSTER_MASK = 0x3fffffff;
+
+struct alignas(CACHELINE_SIZE) hclh_node
+{
+  atomic<unsigned int> state;
+};
+
+// one node per thread and the initial head, nodes move between threads
+hclh_node NODES[MAX_THREADS + 1];
+
+// Hierarchical CLH (Luchangco, Nussbaum, Shavit) as in The Art of
+// Multiprocessor Programming: threads queue on a CLH queue per node and the
+// first one of a batch, the cluster master, splices the whole local queue
+// into the global queue, so consecutive owners tend to share a node
+struct spinlock
+{
+  struct alignas(CACHELINE_SIZE) local_queue
+  {
+    atomic<hclh_node *> tail = {nullptr};
+  };
+  local_queue locals[MAX_NODES];
+  alignas(CACHELINE_SIZE) atomic<hclh_node *> global;
+
+  spinlock()
+  {
+    hclh_node *head = &NODES[MAX_THREADS];
+    head->state.store(0);
+    global.store(head);
+  }
+
+  // true if pred handed the lock over, false if this thread became master
+  bool wait_for_grant_or_master(hclh_node *pred, unsigned int cluster)
+  {
+    while (true)
+    {
+      unsigned int state = pred->state.load();
+      if ((state & CLUSTER_MASK) != cluster or (state & TAIL_WHEN_SPLICED))
+        return false;
+      if (!(state & SUCCESSOR_MUST_WAIT))
+        return true;
+    }
+  }
+
+  // returns the node to use next time
+  hclh_node *lock(hclh_node *me, unsigned int cluster)
+  {
+    me->state.store(cluster | SUCCESSOR_MUST_WAIT);
+    atomic<hclh_node *> &local = locals[cluster].tail;
+    hclh_node *pred = local.load();
+    while (!local.compare_exchange_weak(pred, me))
+      ;
+    if (pred != nullptr && wait_for_grant_or_master(pred, cluster))
+      return pred;
+
+    // cluster master: splice the local queue into the global one
+    hclh_node *local_tail;
+    do
+    {
+      pred = global.load();
+      local_tail = local.load();
+    } while (!global.compare_exchange_weak(pred, local_tail));
+    local_tail->state.fetch_or(TAIL_WHEN_SPLICED);
+    while (pred->state.load() & SUCCESSOR_MUST_WAIT)
+      ;
+    return pred;
+  }
+
+  void unlock(hclh_node *me) { me->state.fetch_and(~SUCCESSOR_MUST_WAIT); }
+} LOCK;
+
+workload W;
+
+void incr(int tid)
+{
+  unsigned int cluster = cluster_of(tid, W);
+  hclh_node *me = &NODES[tid];
+  for (int i = 0; i < W.iterations; i++)
+  {
+    hclh_node *pred = LOCK.lock(me, cluster);
+    critical_section(W);
+    LOCK.unlock(me);
+    me = pred;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  W = parse_args(argc, argv, true, "hclh_lock");
+  run_threads(W, incr);
+  return 0;
+}
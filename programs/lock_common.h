@@ -0,0 +1,176 @@
+#pragma once
+#include <stdlib.h>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// shared by the queue and NUMA-aware lock programs, the critical section is a
+// loop over a shared counter instead of a sleep so traces stay short
+const int CACHELINE_SIZE = 64;
+const int MAX_THREADS = 64;
+const int MAX_NODES = 64;
+
+volatile int counter = 0;
+
+struct workload
+{
+  int num_threads = 2;
+  int numa_nodes = 1;
+  int iterations = 100; // lock acquisitions per thread
+  int cs_length = 10;   // counter increments per critical section
+};
+
+// <num_threads> [numa_nodes] [iterations] [cs_length], numa_nodes only for
+// the NUMA-aware locks
+inline workload parse_args(int argc, char *argv[], bool numa_aware, const string &name)
+{
+  workload w;
+  int optional = numa_aware ? 3 : 2;
+  if (argc < 2 or argc > 2 + optional)
+  {
+    cout << "usage: ./" << name << " <num_threads>" << (numa_aware ? " [numa_nodes]" : "")
+         << " [iterations] [cs_length]\n";
+    exit(0);
+  }
+  int arg = 1;
+  w.num_threads = atoi(argv[arg++]);
+  if (numa_aware && arg < argc)
+    w.numa_nodes = atoi(argv[arg++]);
+  if (arg < argc)
+    w.iterations = atoi(argv[arg++]);
+  if (arg < argc)
+    w.cs_length = atoi(argv[arg++]);
+  if (w.num_threads > MAX_THREADS)
+    w.num_threads = MAX_THREADS;
+  if (w.numa_nodes < 1 or w.numa_nodes > MAX_NODES)
+    w.numa_nodes = 1;
+  return w;
+}
+
+// the node the simulator puts a thread on with the compact affinity: pin
+// numbers the main thread 0 and the workers 1..num_threads - 1 in creation
+// order, and the first num_threads % numa_nodes nodes get one thread more
+inline int cluster_of(int tid, const workload &w)
+{
+  int per_node = w.num_threads / w.numa_nodes;
+  int larger = w.num_threads % w.numa_nodes;
+  int split = larger * (per_node + 1);
+  if (tid < split)
+    return tid / (per_node + 1);
+  return larger + (tid - split) / per_node;
+}
+
+inline void critical_section(const workload &w)
+{
+  for (int i = 0; i < w.cs_length; i++)
+    counter++;
+}
+
+// runs fn(tid) on threads 1..num_threads - 1 like the other lock programs
+template <typename F>
+void run_threads(const workload &w, F fn)
+{
+  vector<thread> thrList;
+  for (int i = 1; i < w.num_threads; i++)
+  {
+    thrList.push_back(thread(fn, i));
+  }
+  for (auto &t : thrList)
+    t.join();
+}
+
+// MCS queue node, each waiter spins on its own line
+struct alignas(CACHELINE_SIZE) mcs_node
+{
+  atomic<mcs_node *> next;
+  atomic<int> state;
+};
+
+// test-and-test-and-set with exponential backoff, the global lock of a cohort
+struct backoff_lock
+{
+  alignas(CACHELINE_SIZE) atomic<bool> l = {false};
+  void lock()
+  {
+    int delay = 1;
+    while (true)
+    {
+      while (l.load())
+        ;
+      if (!l.exchange(true))
+        return;
+      for (volatile int i = 0; i < delay; i++)
+        ;
+      delay = min(delay * 2, 1024);
+    }
+  }
+  void unlock() { l.store(false); }
+};
+
+// C-BO-MCS lock cohorting (Dice, Marathe, Shavit): an MCS lock per node and
+// a backoff lock across nodes. A releasing thread hands both locks to a
+// waiter on its own node, up to MAX_PASSES times, so the global lock and the
+// data it protects stay on one node.
+struct cohort_lock
+{
+  static const int MAX_PASSES = 64;
+  enum
+  {
+    WAIT,
+    RELEASED, // the global lock has to be acquired
+    PASSED    // the global lock came with the local one
+  };
+  struct alignas(CACHELINE_SIZE) local_lock
+  {
+    atomic<mcs_node *> tail = {nullptr};
+    int passes = 0; // only touched by the holder
+  };
+
+  backoff_lock global;
+  local_lock locals[MAX_NODES];
+
+  void lock(mcs_node *me, int cluster)
+  {
+    local_lock &local = locals[cluster];
+    me->next.store(nullptr);
+    me->state.store(WAIT);
+    mcs_node *prev = local.tail.exchange(me);
+    if (prev != nullptr)
+    {
+      prev->next.store(me);
+      int state;
+      while ((state = me->state.load()) == WAIT)
+        ;
+      if (state == PASSED)
+        return;
+    }
+    global.lock();
+    local.passes = 0;
+  }
+
+  void unlock(mcs_node *me, int cluster)
+  {
+    local_lock &local = locals[cluster];
+    mcs_node *succ = me->next.load();
+    if (succ != nullptr && local.passes < MAX_PASSES)
+    {
+      local.passes++;
+      succ->state.store(PASSED);
+      return;
+    }
+    global.unlock();
+    if (succ == nullptr)
+    {
+      mcs_node *expected = me;
+      if (local.tail.compare_exchange_strong(expected, nullptr))
+        return;
+      while ((succ = me->next.load()) == nullptr)
+        ;
+    }
+    succ->state.store(RELEASED);
+  }
+};
@@ -0,0 +1,53 @@
+#include "lock_common.h"
+
+// Mellor-Crummey and Scott: waiters queue up and each spins on a flag in its
+// own node, so a release touches one remote line
+struct spinlock
+{
+  alignas(CACHELINE_SIZE) atomic<mcs_node *> tail = {nullptr};
+  void lock(mcs_node *me)
+  {
+    me->next.store(nullptr);
+    me->state.store(1);
+    mcs_node *prev = tail.exchange(me);
+    if (prev == nullptr)
+      return;
+    prev->next.store(me);
+    while (me->state.load() == 1)
+      ;
+  }
+  void unlock(mcs_node *me)
+  {
+    mcs_node *succ = me->next.load();
+    if (succ == nullptr)
+    {
+      mcs_node *expected = me;
+      if (tail.compare_exchange_strong(expected, nullptr))
+        return;
+      // a waiter swapped the tail but has not linked itself in yet
+      while ((succ = me->next.load()) == nullptr)
+        ;
+    }
+    succ->state.store(0);
+  }
+} LOCK;
+
+workload W;
+
+void incr(int)
+{
+  mcs_node me;
+  for (int i = 0; i < W.iterations; i++)
+  {
+    LOCK.lock(&me);
+    critical_section(W);
+    LOCK.unlock(&me);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  W = parse_args(argc, argv, false, "mcs_lock");
+  run_threads(W, incr);
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "lock_common.h"
+
+// every WRITE_EVERY-th acquisition of a thread writes, the rest read
+const int WRITE_EVERY = 10;
+
+struct alignas(CACHELINE_SIZE) reader_count
+{
+  atomic<int> count = {0};
+};
+
+// C-RW-WP (Calciu et al.): readers only touch a counter on their own node and
+// writers, which take priority, serialize on a cohort lock, so read-mostly
+// phases cause no global traffic
+struct rwlock
+{
+  reader_count readers[MAX_NODES];
+  alignas(CACHELINE_SIZE) atomic<bool> writer_active = {false};
+  cohort_lock writers;
+
+  void read_lock(int cluster)
+  {
+    while (true)
+    {
+      readers[cluster].count.fetch_add(1);
+      if (!writer_active.load())
+        return;
+      readers[cluster].count.fetch_sub(1);
+      while (writer_active.load())
+        ;
+    }
+  }
+  void read_unlock(int cluster) { readers[cluster].count.fetch_sub(1); }
+
+  void write_lock(mcs_node *me, int cluster, int numa_nodes)
+  {
+    writers.lock(me, cluster);
+    writer_active.store(true);
+    for (int node = 0; node < numa_nodes; node++)
+      while (readers[node].count.load() != 0)
+        ;
+  }
+  void write_unlock(mcs_node *me, int cluster)
+  {
+    writer_active.store(false);
+    writers.unlock(me, cluster);
+  }
+} LOCK;
+
+workload W;
+
+void read_section()
+{
+  int sum = 0;
+  for (int i = 0; i < W.cs_length; i++)
+    sum += counter;
+  (void)sum;
+}
+
+void incr(int tid)
+{
+  int cluster = cluster_of(tid, W);
+  mcs_node me;
+  for (int i = 0; i < W.iterations; i++)
+  {
+    if (i % WRITE_EVERY == 0)
+    {
+      LOCK.write_lock(&me, cluster, W.numa_nodes);
+      critical_section(W);
+      LOCK.write_unlock(&me, cluster);
+    }
+    else
+    {
+      LOCK.read_lock(cluster);
+      read_section();
+      LOCK.read_unlock(cluster);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  W = parse_args(argc, argv, true, "numa_rwlock");
+  run_threads(W, incr);
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <fstream>
+#include <sstream>
+
+#include "affinity.h"
+#include "machine.h"
+
+const char *affinityName(AffinityPolicy policy)
+{
+    switch (policy)
+    {
+    case AffinityPolicy::COMPACT:
+        return "compact";
+    case AffinityPolicy::SCATTER:
+        return "scatter";
+    case AffinityPolicy::MAP:
+        return "map";
+    }
+    return "unknown";
+}
+
+Affinity::Affinity(AffinityPolicy policy, int procs, int numa_nodes)
+    : policy_(policy),
+      num_procs_(procs),
+      numa_nodes_(numa_nodes)
+{
+    if (policy_ == AffinityPolicy::COMPACT)
+    {
+        for (int thread = 0; thread < procs; ++thread)
+            procs_.push_back(thread);
+    }
+    else if (policy_ == AffinityPolicy::SCATTER)
+    {
+        // the next free proc of every node, full nodes are skipped
+        std::vector<int> next(numa_nodes), end(numa_nodes);
+        for (int node = 0; node < numa_nodes; ++node)
+        {
+            next[node] = firstProcOfNode(node, procs, numa_nodes);
+            end[node] = firstProcOfNode(node + 1, procs, numa_nodes);
+        }
+        int node = 0;
+        for (int thread = 0; thread < procs; ++thread)
+        {
+            while (next[node] == end[node])
+                node = (node + 1) % numa_nodes;
+            procs_.push_back(next[node]++);
+            node = (node + 1) % numa_nodes;
+        }
+    }
+}
+
+std::string Affinity::loadMap(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return "cannot open " + path;
+
+    procs_.clear();
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(file, line))
+    {
+        line_no++;
+        std::istringstream fields(line.substr(0, line.find('#')));
+        int proc;
+        while (fields >> proc)
+        {
+            if (proc < 0 || proc >= num_procs_)
+                return "invalid proc " + std::to_string(proc) + " on line " + std::to_string(line_no);
+            procs_.push_back(proc);
+        }
+        if (!fields.eof())
+            return "malformed line " + std::to_string(line_no);
+    }
+    if (procs_.empty())
+        return path + " maps no threads";
+    return "";
+}
+
+void Affinity::printReport(std::ostream &out) const
+{
+    out << "\t** Thread Placement (" << affinityName(policy_) << ") ***\n\n";
+    std::vector<int> threads_per_proc(num_procs_, 0);
+    for (int proc : procs_)
+        threads_per_proc[proc] += 1;
+    for (int node = 0; node < numa_nodes_; ++node)
+    {
+        out << "Node " << node << ":\t";
+        for (int thread = 0; thread < (int)procs_.size(); ++thread)
+            if (procToNode(procs_[thread], num_procs_, numa_nodes_) == node)
+                out << " " << thread << "->" << procs_[thread];
+        out << "\n";
+    }
+    int shared = 0;
+    for (int threads : threads_per_proc)
+        shared += threads > 1;
+    out << "Shared Procs:\t" << shared << "\n"
+        << std::endl;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+
+// how trace threads are pinned to simulated procs, like taskset or
+// OMP_PROC_BIND
+enum class AffinityPolicy
+{
+    COMPACT, // thread i on proc i, filling one node after the other
+    SCATTER, // consecutive threads on different nodes, round robin
+    MAP      // an explicit thread -> proc list from a file
+};
+
+const char *affinityName(AffinityPolicy policy);
+
+// Maps the thread ids recorded in a trace onto procs, so one trace can be
+// simulated under different placements.
+class Affinity
+{
+public:
+    Affinity(AffinityPolicy policy, int procs, int numa_nodes);
+
+    // one proc per thread in thread order, '#' starts a comment. Returns an
+    // error message, "" on success
+    std::string loadMap(const std::string &path);
+
+    // -1 if the thread has no proc
+    int proc(int thread) const
+    {
+        return thread >= 0 && thread < (int)procs_.size() ? procs_[thread] : -1;
+    }
+
+    void printReport(std::ostream &out) const;
+
+private:
+    AffinityPolicy policy_;
+    int num_procs_;
+    int numa_nodes_;
+    std::vector<int> procs_; // indexed by thread
+};
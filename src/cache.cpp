@@ -1,6 +1,10 @@
+#include <sstream>
+
 #include "cache.h"
+#include "checkpoint.h"
 #include "numa_node.h"
 #include "latencies.h"
+#include "sharing_analyzer.h"
 
 Cache::Cache(int id, int index_len, int ways, int offset_len, Protocol protocol)
     : cache_id_(id),
@@ -9,17 +13,33 @@ Cache::Cache(int id, int index_len, int ways, int offset_len, Protocol protocol)
       ways_(ways),
       offset_len_(offset_len),
       line_size_(1 << offset_len),
-      protocol_(protocol)
+      protocol_(protocol),
+      silent_evictions_(false),
+      numa_node_(nullptr),
+      analyzer_(nullptr),
+      prefetcher_(nullptr),
+      prefetch_page_bits_(PREFETCH_PAGE_BITS),
+      accesses_(0)
 {
     for (int i = 0; i < set_size_; i++)
-        sets_.push_back(std::make_shared<Set>(ways, protocol_));
+        sets_.push_back(std::make_shared<Set>(ways, protocol_, &stats_));
 };
 
+Cache::~Cache()
+{
+    delete prefetcher_;
+}
+
 void Cache::assignToNode(NUMANode *node)
 {
     numa_node_ = node;
 };
 
+void Cache::attachAnalyzer(SharingAnalyzer *analyzer)
+{
+    analyzer_ = analyzer;
+};
+
 int Cache::getID() const
 {
     return cache_id_;
@@ -52,6 +72,15 @@ CacheBlock *Cache::findInSet(size_t tag, size_t index)
     return target;
 };
 
+CacheBlock *Cache::lookup(size_t addr)
+{
+    std::pair<size_t, size_t> pair = splitAddr(addr);
+    for (CacheBlock *block : sets_[pair.second]->blocks_)
+        if (block->isValid() && block->getTag() == pair.first)
+            return block;
+    return nullptr;
+}
+
 CacheBlock *Cache::findInCache(size_t addr)
 {
     std::pair<size_t, size_t> pair = splitAddr(addr);
@@ -65,56 +94,149 @@ CacheBlock *Cache::findInCache(size_t addr)
 void Cache::receiveMsg(size_t addr, DirectoryMsg msg, int request_node_id)
 {
     CacheBlock *block = findInCache(addr);
+    if (block == nullptr)
+    {
+        // the directory still lists this cache for a line it dropped silently
+        if (msg == DirectoryMsg::INVALIDATE)
+            stats_.stale_invalidations_ += 1;
+        else if (msg == DirectoryMsg::FETCH)
+        {
+            stats_.stale_fetches_ += 1;
+            numa_node_->emitCacheMsg(cache_id_, {addr, request_node_id}, CacheMsg::NACK);
+        }
+        return;
+    }
     switch (msg)
     {
     case DirectoryMsg::READDATA_EX:
         block->receiveReadData(true);
+        numa_node_->fillShared({addr, block->getNodeID()});
         break;
     case DirectoryMsg::READDATA:
         block->receiveReadData(false);
+        numa_node_->fillShared({addr, block->getNodeID()});
         break;
     case DirectoryMsg::WRITEDATA:
         block->receiveWriteData();
+        numa_node_->fillShared({addr, block->getNodeID()});
         break;
     case DirectoryMsg::FETCH:
         block->fetch();
         numa_node_->emitCacheMsg(cache_id_, {addr, request_node_id}, CacheMsg::DATA, block->isDirty());
         break;
     case DirectoryMsg::INVALIDATE:
+        if (block->isPrefetched())
+        {
+            stats_.unused_prefetches_ += 1;
+            block->setPrefetched(false);
+        }
         block->invalidate();
+        if (analyzer_)
+            analyzer_->recordInvalidation(cache_id_, addr);
         break;
     }
 }
 
-void Cache::cacheWrite(Addr addr)
+void Cache::cacheWrite(Addr addr, size_t ip)
 {
-    return performOperation(addr, true);
+    return performOperation(addr, true, ip);
 };
 
-void Cache::cacheRead(Addr addr)
+void Cache::cacheRead(Addr addr, size_t ip)
 {
-    return performOperation(addr, false);
+    return performOperation(addr, false, ip);
 };
 
-void Cache::performOperation(Addr addr, bool is_write)
+bool Cache::repeatHits(size_t addr, bool is_write, size_t count)
+{
+    if (prefetcher_ || analyzer_)
+        return false;
+    CacheBlock *block = lookup(addr);
+    if (block == nullptr || block->isPrefetched() || (is_write && !block->isModified()))
+        return false;
+
+    // the same aging as count calls of findInSet and a hit on block
+    for (CacheBlock *other : sets_[splitAddr(addr).second]->blocks_)
+        other->setLruCnt(other->getLruCnt() + count);
+    block->setLruCnt(0);
+    accesses_ += count;
+    stats_.hits_ += count;
+    return true;
+}
+
+void Cache::performOperation(Addr addr, bool is_write, size_t ip)
 {
     std::pair<size_t, size_t> pair = splitAddr(addr.addr);
     size_t tag = pair.first;
     size_t index = pair.second;
 
+    accesses_ += 1;
     CacheBlock *block = findInSet(tag, index);
 
+    bool first_use = block != nullptr && block->isPrefetched();
+    if (first_use)
+    {
+        stats_.useful_prefetches_ += 1;
+        if (accesses_ < block->getReadyAt())
+            stats_.late_prefetches_ += 1;
+        block->setPrefetched(false);
+    }
+
+    CacheMsg msg = CacheMsg::NOP;
     if (block != nullptr)
-        numa_node_->emitCacheMsg(
-            cache_id_,
-            addr,
-            is_write ? block->writeBlock(addr.node_id)
-                     : block->readBlock(addr.node_id));
+    {
+        // upgrades go to the directory the line was filled from
+        msg = is_write ? block->writeBlock() : block->readBlock();
+        numa_node_->emitCacheMsg(cache_id_, {addr.addr, block->getNodeID()}, msg);
+    }
     else
         evictAndReplace(tag, index, addr, is_write);
+
+    if (analyzer_)
+        analyzer_->recordAccess(cache_id_, addr.addr, is_write, block == nullptr, msg == CacheMsg::BUSRDX);
+
+    if (prefetcher_)
+        issuePrefetches(addr, ip, block == nullptr || first_use);
 };
 
-void Cache::evictAndReplace(size_t tag, size_t index, Addr addr, bool is_write)
+void Cache::issuePrefetches(Addr addr, size_t ip, bool trigger)
+{
+    prefetch_lines_.clear();
+    prefetcher_->observe(addr.addr, ip, trigger, prefetch_lines_);
+    for (size_t line : prefetch_lines_)
+    {
+        // the home node of another page is unknown
+        if (line >> prefetch_page_bits_ != addr.addr >> prefetch_page_bits_)
+            continue;
+        prefetch({line, addr.node_id});
+    }
+}
+
+// a coherent read fill through the directory that does not count as a miss
+void Cache::prefetch(Addr line)
+{
+    std::pair<size_t, size_t> pair = splitAddr(line.addr);
+    size_t tag = pair.first;
+    size_t index = pair.second;
+
+    // prefetches are not accesses
+    if (lookup(line.addr) != nullptr)
+        return;
+
+    bool remote = line.node_id != numa_node_->getID();
+    size_t global_events = numa_node_->getMachineGlobalEvents();
+    CacheBlock *block = evictAndReplace(tag, index, line, false);
+    stats_.misses_ -= 1;
+
+    // the fill takes a memory access and a round trip, one cache access per ns
+    size_t fill_latency = MEMORY_LATENCY + 2 * (remote ? GLOBAL_INTERCONNECT_LATENCY : LOCAL_INTERCONNECT_LATENCY);
+    block->setPrefetched(true, accesses_ + fill_latency / CACHE_LATENCY);
+    stats_.prefetches_ += 1;
+    stats_.remote_prefetches_ += remote;
+    stats_.prefetch_global_events_ += numa_node_->getMachineGlobalEvents() - global_events;
+}
+
+CacheBlock *Cache::evictAndReplace(size_t tag, size_t index, Addr addr, bool is_write)
 {
     std::shared_ptr<Set> set = sets_[index];
     std::vector<CacheBlock *>::iterator evict_block = set->blocks_.begin();
@@ -131,16 +253,49 @@ void Cache::evictAndReplace(size_t tag, size_t index, Addr addr, bool is_write)
         }
     }
 
+    if ((*evict_block)->isValid() && (*evict_block)->isPrefetched())
+        stats_.unused_prefetches_ += 1;
+    (*evict_block)->setPrefetched(false);
+
     if ((*evict_block)->isValid())
     {
         size_t old_tag = (*evict_block)->getTag() << (index_len_ + offset_len_);
         size_t set_mask = ((1 << index_len_) - 1) << offset_len_;
-        numa_node_->emitCacheMsg(cache_id_, {old_tag | (addr.addr & set_mask), (*evict_block)->getNodeID()}, CacheMsg::EVICTION);
+        Addr old_addr = {old_tag | (addr.addr & set_mask), (*evict_block)->getNodeID()};
+        if (silent_evictions_ && !(*evict_block)->isDirty())
+            stats_.silent_evictions_ += 1;
+        else
+            numa_node_->emitCacheMsg(cache_id_, old_addr, CacheMsg::EVICTION, (*evict_block)->isDirty());
+        numa_node_->evictPrivate(old_addr, (*evict_block)->isDirty());
     }
     CacheMsg msg = (*evict_block)->evictAndReplace(is_write, tag, addr.node_id);
-    numa_node_->emitCacheMsg(cache_id_, addr, msg);
+    // a shared cache of the node can serve reads without leaving it
+    if (msg == CacheMsg::BUSRD && numa_node_->readShared(cache_id_, addr))
+        (*evict_block)->receiveReadData(false);
+    else
+        numa_node_->emitCacheMsg(cache_id_, addr, msg);
+    return *evict_block;
 };
 
+bool Cache::backInvalidate(size_t addr)
+{
+    CacheBlock *block = lookup(addr);
+    if (block == nullptr)
+        return false;
+    if (block->isDirty())
+        stats_.flushes_ += 1;
+    if (block->isDirty() || !silent_evictions_)
+        numa_node_->emitCacheMsg(cache_id_, {addr, block->getNodeID()}, CacheMsg::EVICTION, block->isDirty());
+    if (block->isPrefetched())
+    {
+        stats_.unused_prefetches_ += 1;
+        block->setPrefetched(false);
+    }
+    block->invalidate();
+    stats_.back_invalidations_ += 1;
+    return true;
+}
+
 void Cache::printConfig() const
 {
     std::cout << "set size:\t" << set_size_ << "\n"
@@ -150,21 +305,85 @@ void Cache::printConfig() const
 
 CacheStats Cache::getStats() const
 {
-    CacheStats stats;
-    for (auto set : sets_)
+    CacheStats stats = stats_;
+    stats.memory_writes_ = stats.dirty_evictions_ + stats.flushes_;
+    return stats;
+}
+
+// every counter of CacheStats, in checkpoint order
+static size_t CacheStats::*const CHECKPOINT_STATS[] = {
+    &CacheStats::hits_, &CacheStats::misses_, &CacheStats::flushes_, &CacheStats::invalidations_,
+    &CacheStats::evictions_, &CacheStats::dirty_evictions_, &CacheStats::memory_writes_,
+    &CacheStats::silent_evictions_, &CacheStats::stale_invalidations_, &CacheStats::stale_fetches_,
+    &CacheStats::prefetches_, &CacheStats::remote_prefetches_, &CacheStats::useful_prefetches_,
+    &CacheStats::late_prefetches_, &CacheStats::unused_prefetches_, &CacheStats::prefetch_global_events_,
+    &CacheStats::back_invalidations_};
+
+void Cache::save(CheckpointWriter &out) const
+{
+    out.put(accesses_);
+    for (size_t CacheStats::*field : CHECKPOINT_STATS)
+        out.put(stats_.*field);
+
+    for (const std::shared_ptr<Set> &set : sets_)
+        for (CacheBlock *block : set->blocks_)
+        {
+            // state + 1, an invalid way is a single 0
+            if (!block->isValid())
+            {
+                out.put(0);
+                continue;
+            }
+            out.put(block->getState() + 1);
+            out.put(block->isDirty());
+            out.put(block->getTag());
+            out.put(block->getLruCnt());
+            out.put(block->getNodeID());
+            out.put(block->isPrefetched());
+            if (block->isPrefetched())
+                out.put(block->getReadyAt());
+        }
+
+    // empty without a prefetcher, the restoring run may use another one
+    std::ostringstream section;
+    if (prefetcher_)
     {
+        CheckpointWriter state(section);
+        state.put((uint64_t)prefetcher_->getPolicy());
+        prefetcher_->save(state);
+    }
+    out.putString(section.str());
+}
+
+void Cache::load(CheckpointReader &in)
+{
+    accesses_ = in.get();
+    for (size_t CacheStats::*field : CHECKPOINT_STATS)
+        stats_.*field = in.get();
+
+    for (std::shared_ptr<Set> &set : sets_)
         for (CacheBlock *block : set->blocks_)
         {
-            stats.hits_ += block->getHitCnt();
-            stats.misses_ += block->getMissCnt();
-            stats.flushes_ += block->getFlushCnt();
-            stats.invalidations_ += block->getInvalidationCnt();
-            stats.evictions_ += block->getEvictionCnt();
-            stats.dirty_evictions_ += block->getDirtyEvictionCnt();
+            int state = in.get();
+            if (state == 0)
+                continue;
+            bool dirty = in.get();
+            size_t tag = in.get();
+            size_t lru_cnt = in.get();
+            int node_id = in.get();
+            block->restore(state - 1, dirty, tag, lru_cnt, node_id);
+            if (in.get())
+                block->setPrefetched(true, in.get());
         }
+
+    // a different prefetcher starts untrained
+    std::istringstream section(in.getString());
+    if (prefetcher_ && section.rdbuf()->in_avail() > 0)
+    {
+        CheckpointReader state(section);
+        if (state.get() == (uint64_t)prefetcher_->getPolicy())
+            prefetcher_->load(state);
     }
-    stats.memory_writes_ = stats.dirty_evictions_ + stats.flushes_;
-    return stats;
 }
 
 void Cache::printState() const
@@ -179,5 +398,10 @@ void Cache::printState() const
               << "Invalidations:\t\t" << stats.invalidations_ << "\n"
               << "Cache Access Latency:\t" << outputLatency(stats.hits_ * CACHE_LATENCY) << "\n"
               << "Memory Write Latency:\t" << outputLatency(stats.memory_writes_ * MEMORY_LATENCY)
-              << "\n\n";
+              << "\n";
+    if (silent_evictions_)
+        std::cout << "Silent Evictions:\t" << stats.silent_evictions_ << "\n"
+                  << "Stale Invalidations:\t" << stats.stale_invalidations_ << "\n"
+                  << "Stale Fetches:\t\t" << stats.stale_fetches_ << "\n";
+    std::cout << "\n";
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <vector>
 
 #include "cache_block.h"
+#include "prefetcher.h"
+#include "mesi_block.h"
+#include "mesif_block.h"
 #include "moesi_block.h"
 #include "msi_block.h"
 
@@ -28,22 +31,30 @@ struct Addr
 enum class Protocol
 {
     MSI,
+    MESI,
+    MESIF,
     MOESI
 };
 
 struct Set
 {
-    Set(int ways, Protocol proto)
+    Set(int ways, Protocol proto, CacheStats *stats)
     {
         for (int i = 0; i < ways; i++)
         {
             switch (proto)
             {
             case Protocol::MSI:
-                blocks_.push_back(new MSIBlock());
+                blocks_.push_back(new MSIBlock(stats));
+                break;
+            case Protocol::MESI:
+                blocks_.push_back(new MESIBlock(stats));
+                break;
+            case Protocol::MESIF:
+                blocks_.push_back(new MESIFBlock(stats));
                 break;
             case Protocol::MOESI:
-                blocks_.push_back(new MOESIBlock());
+                blocks_.push_back(new MOESIBlock(stats));
                 break;
             }
         }
@@ -51,26 +62,46 @@ struct Set
     std::vector<CacheBlock *> blocks_;
 };
 
-struct CacheStats
-{
-    size_t hits_ = 0, misses_ = 0, flushes_ = 0, invalidations_ = 0, evictions_ = 0,
-           dirty_evictions_ = 0, memory_writes_ = 0;
-};
-
 class NUMANode;
+class SharingAnalyzer;
+class CheckpointWriter;
+class CheckpointReader;
 
 class Cache
 {
 public:
     // 2^index_len sets, 2^offset_len bytes per block and ways
     Cache(int id, int index_len, int ways, int offset_len, Protocol protocol);
+    ~Cache();
 
-    void cacheWrite(Addr addr);
-    void cacheRead(Addr addr);
+    // ip is only used by the prefetcher, 0 if unknown
+    void cacheWrite(Addr addr, size_t ip = 0);
+    void cacheRead(Addr addr, size_t ip = 0);
+    // count more accesses to a line the last access left in a state where
+    // they all hit without a message, in O(ways). False without touching
+    // anything if they would not, or if a prefetcher or an analyzer has to
+    // see every access.
+    bool repeatHits(size_t addr, bool is_write, size_t count);
 
     void assignToNode(NUMANode *node);
+    void attachAnalyzer(SharingAnalyzer *analyzer);
+    // drop clean lines without telling the directory
+    void enableSilentEvictions() { silent_evictions_ = true; }
+    // takes ownership of the prefetcher, which stays within pages of
+    // 2^page_bits bytes as only the home of the accessed page is known
+    void attachPrefetcher(Prefetcher *prefetcher, int page_bits)
+    {
+        prefetcher_ = prefetcher;
+        prefetch_page_bits_ = page_bits;
+    }
 
     void receiveMsg(size_t addr, DirectoryMsg msg, int request_node_id);
+    // an inclusive shared cache dropped the line, false if it was not here
+    bool backInvalidate(size_t addr);
+
+    // every valid line, the counters and the prefetcher's training state
+    void save(CheckpointWriter &out) const;
+    void load(CheckpointReader &in);
 
     int getID() const;
     void printConfig() const;
@@ -78,13 +109,16 @@ public:
     void printState() const;
 
 private:
-    void performOperation(Addr address, bool is_write);
+    void performOperation(Addr address, bool is_write, size_t ip);
+    void issuePrefetches(Addr addr, size_t ip, bool trigger);
+    void prefetch(Addr line);
 
     CacheBlock *findInCache(size_t addr);
+    CacheBlock *lookup(size_t addr); // without aging the set
     std::pair<size_t, size_t> splitAddr(size_t addr); // tag & set index
     CacheBlock *findInSet(size_t tag, size_t index);
 
-    void evictAndReplace(size_t tag, size_t index, Addr addr, bool is_write);
+    CacheBlock *evictAndReplace(size_t tag, size_t index, Addr addr, bool is_write);
     void performMessage(CacheMsg msg, Addr addr);
     void sendEviction(size_t tag, size_t addr, int numa_node);
 
@@ -95,7 +129,14 @@ private:
     int offset_len_;
     int line_size_;
     Protocol protocol_;
+    bool silent_evictions_;
 
     NUMANode *numa_node_;
+    SharingAnalyzer *analyzer_;
+    Prefetcher *prefetcher_;
+    int prefetch_page_bits_;
+    std::vector<size_t> prefetch_lines_; // reused between accesses
+    size_t accesses_;
     std::vector<std::shared_ptr<Set>> sets_;
+    CacheStats stats_;
 };
\ No newline at end of file
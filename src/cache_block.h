@@ -2,6 +2,22 @@
 #include <stddef.h>
 #include <cassert>
 
+// counters shared by all blocks of one cache, so reading them is O(1)
+struct CacheStats
+{
+    size_t hits_ = 0, misses_ = 0, flushes_ = 0, invalidations_ = 0, evictions_ = 0,
+           dirty_evictions_ = 0, memory_writes_ = 0;
+    // only with silent clean evictions: dropped lines and the directory
+    // messages that still arrived for them
+    size_t silent_evictions_ = 0, stale_invalidations_ = 0, stale_fetches_ = 0;
+    // only with a prefetcher, prefetch fills are not counted as misses
+    size_t prefetches_ = 0, remote_prefetches_ = 0, useful_prefetches_ = 0, late_prefetches_ = 0,
+           unused_prefetches_ = 0, prefetch_global_events_ = 0;
+    // lines dropped because an inclusive shared cache evicted them, these
+    // are also counted as invalidations
+    size_t back_invalidations_ = 0;
+};
+
 enum class CacheMsg
 {
     NOP,
@@ -10,6 +26,7 @@ enum class CacheMsg
     EVICTION,
     DATA,
     BROADCAST,
+    NACK, // reply to a fetch for a line that was dropped silently
 };
 
 class CacheBlock
@@ -22,51 +39,63 @@ protected:
 
     int node_id_;
 
-    // metrics
-    size_t flushes_;
-    size_t hit_;
-    size_t miss_;
-    size_t invalidations_;
-    size_t evictions_;
-    size_t dirty_evictions_;
+    // filled by a prefetch and not used by a demand access yet
+    bool prefetched_;
+    size_t ready_at_; // cache access count at which the prefetch completes
+
+    // metrics, owned by the cache
+    CacheStats *stats_;
 
     virtual CacheMsg updateState(bool is_write) = 0;
 
 public:
-    CacheBlock()
+    CacheBlock(CacheStats *stats)
         : dirty_(false),
           tag_(0),
           lru_cnt_(0),
-          flushes_(0),
-          hit_(0),
-          miss_(0),
-          invalidations_(0),
-          evictions_(0),
-          dirty_evictions_(0) {}
+          prefetched_(false),
+          ready_at_(0),
+          stats_(stats) {}
     virtual ~CacheBlock(){};
 
     // Get metadata about the block
     virtual bool isValid() = 0;
+    // the protocol state as an integer, for checkpoints
+    virtual int getState() const = 0;
+    virtual void setState(int state) = 0;
+    // the only state in which a write hits without a message or a change
+    virtual bool isModified() const = 0;
     bool isDirty() const { return dirty_; }
     size_t getLruCnt() const { return lru_cnt_; }
     size_t getTag() const { return tag_; }
     void incrLruCnt() { lru_cnt_++; }
+    void setLruCnt(size_t lru_cnt) { lru_cnt_ = lru_cnt; }
     int getNodeID() { return node_id_; }
+    bool isPrefetched() const { return prefetched_; }
+    size_t getReadyAt() const { return ready_at_; }
+    void setPrefetched(bool prefetched, size_t ready_at = 0)
+    {
+        prefetched_ = prefetched;
+        ready_at_ = ready_at;
+    }
+
+    // a valid line as saved in a checkpoint
+    void restore(int state, bool dirty, size_t tag, size_t lru_cnt, int node_id)
+    {
+        setState(state);
+        dirty_ = dirty;
+        tag_ = tag;
+        lru_cnt_ = lru_cnt;
+        node_id_ = node_id;
+    }
 
-    virtual CacheMsg writeBlock(int node_id) = 0;
-    virtual CacheMsg readBlock(int node_id) = 0;
+    // hits keep the home node the line was filled from
+    virtual CacheMsg writeBlock() = 0;
+    virtual CacheMsg readBlock() = 0;
     virtual CacheMsg evictAndReplace(bool is_write, size_t tag, int new_node) = 0;
 
     virtual void invalidate() = 0;
     virtual void fetch() = 0; // fetch a line, send it to main memory if dirty_ == true
     virtual void receiveReadData(bool exclusive) = 0;
     virtual void receiveWriteData() = 0;
-
-    // Get stats on the block
-    size_t getHitCnt() { return hit_; }
-    size_t getMissCnt() { return miss_; }
-    size_t getFlushCnt() { return flushes_; }
-    size_t getEvictionCnt() { return evictions_; }
-    size_t getInvalidationCnt() { return invalidations_; }
-    size_t getDirtyEvictionCnt() { return dirty_evictions_; }
 };
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "checkpoint.h"
+#include "numa_node.h"
+#include "page_mapper.h"
+#include "page_migrator.h"
+
+static const char CHECKPOINT_MAGIC[] = "NUMASIM-CKPT";
+static const uint64_t CHECKPOINT_VERSION = 5;
+
+void CheckpointWriter::put(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out_.put((char)(value | 0x80));
+        value >>= 7;
+    }
+    out_.put((char)value);
+}
+
+void CheckpointWriter::putSigned(int64_t value)
+{
+    // zigzag, so -1 owners are a single byte too
+    put(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+void CheckpointWriter::putString(const std::string &value)
+{
+    put(value.size());
+    out_.write(value.data(), value.size());
+}
+
+uint64_t CheckpointReader::get()
+{
+    uint64_t value = 0;
+    for (int shift = 0; ok_ && shift < 64; shift += 7)
+    {
+        int byte = in_.get();
+        if (byte == EOF)
+            break;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+    ok_ = false;
+    return 0;
+}
+
+int64_t CheckpointReader::getSigned()
+{
+    uint64_t value = get();
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+std::string CheckpointReader::getString()
+{
+    uint64_t size = get();
+    std::string value;
+    if (!ok_)
+        return value;
+    value.resize(size);
+    if (!in_.read(&value[0], size))
+    {
+        ok_ = false;
+        value.clear();
+    }
+    return value;
+}
+
+// the geometry a checkpoint can only be restored into
+static void putConfig(CheckpointWriter &out, const RunInfo &info)
+{
+    out.putString(info.protocol);
+    out.put(info.procs);
+    out.put(info.numa_nodes);
+    out.put(info.index_len);
+    out.put(info.ways);
+    out.put(info.offset_len);
+    // the trace position is only meaningful in the same order
+    out.putString(info.order);
+}
+
+static std::string checkConfig(CheckpointReader &in, const RunInfo &info)
+{
+    std::string protocol = in.getString();
+    if (protocol != info.protocol)
+        return "checkpoint uses the " + protocol + " protocol";
+    if ((int)in.get() != info.procs || (int)in.get() != info.numa_nodes)
+        return "checkpoint has a different number of processors or nodes";
+    if ((int)in.get() != info.index_len || (int)in.get() != info.ways || (int)in.get() != info.offset_len)
+        return "checkpoint has a different cache geometry";
+    std::string order = in.getString();
+    if (order != info.order)
+        return "checkpoint merged the trace in " + order + " order";
+    return "";
+}
+
+bool writeCheckpoint(const std::string &path, const RunInfo &info, const std::vector<NUMANode *> &nodes,
+                     const PageMapper *page_mapper, const PageMigrator *migrator, const TracePosition &position)
+{
+    // written next to the old checkpoint and renamed, a crash keeps the old one
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    CheckpointWriter out(file);
+    file.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    out.put(CHECKPOINT_VERSION);
+    putConfig(out, info);
+    out.put(position.offset);
+    out.put(position.line_no);
+    out.put(position.accesses);
+    out.put(position.accesses_skip0);
+    out.put(position.sizes.sized_accesses);
+    out.put(position.sizes.bytes);
+    out.put(position.sizes.split_accesses);
+    out.put(position.sizes.line_requests);
+    out.put(position.sizes.unresolved_lines);
+    out.put(position.atomics.atomics);
+    out.put(position.atomics.owned);
+    out.put(position.atomics.latency);
+
+    for (const NUMANode *node : nodes)
+        node->save(out);
+
+    out.put(page_mapper != nullptr);
+    if (page_mapper)
+        page_mapper->save(out);
+    out.put(migrator != nullptr);
+    if (migrator)
+        migrator->save(out);
+
+    file.close();
+    if (!file)
+        return false;
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+std::string readCheckpoint(const std::string &path, const RunInfo &info, const std::vector<NUMANode *> &nodes,
+                           PageMapper *page_mapper, PageMigrator *migrator, TracePosition &position)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return "cannot open " + path;
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    CheckpointReader in(file);
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0)
+        return path + " is not a checkpoint";
+    if (in.get() != CHECKPOINT_VERSION)
+        return path + " was written by another version of the simulator";
+
+    std::string error = checkConfig(in, info);
+    if (error != "")
+        return error;
+    position.offset = in.get();
+    position.line_no = in.get();
+    position.accesses = in.get();
+    position.accesses_skip0 = in.get();
+    position.sizes.sized_accesses = in.get();
+    position.sizes.bytes = in.get();
+    position.sizes.split_accesses = in.get();
+    position.sizes.line_requests = in.get();
+    position.sizes.unresolved_lines = in.get();
+    position.atomics.atomics = in.get();
+    position.atomics.owned = in.get();
+    position.atomics.latency = in.get();
+
+    for (NUMANode *node : nodes)
+        node->load(in);
+
+    // homes decide which directory tracks a cached line, they cannot change
+    bool had_mapper = in.get();
+    if (had_mapper != (page_mapper != nullptr))
+        return had_mapper ? "checkpoint was taken with --placement" : "checkpoint was taken without --placement";
+    if (page_mapper && !page_mapper->load(in))
+        return "checkpoint used another placement policy or page size";
+    bool had_migrator = in.get();
+    if (had_migrator != (migrator != nullptr))
+        return had_migrator ? "checkpoint was taken with --migrate" : "checkpoint was taken without --migrate";
+    if (migrator && !migrator->load(in))
+        return "checkpoint used another page size";
+
+    if (!in.ok())
+        return path + " is truncated";
+    return "";
+}
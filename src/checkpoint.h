@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+#include "numasim.h"
+#include "results_writer.h"
+
+class NUMANode;
+class PageMapper;
+class PageMigrator;
+
+// Every integer is a LEB128 varint, so counters and empty ways mostly take a
+// byte. Optional parts are written as length prefixed sections that a reader
+// can skip when they no longer match the machine.
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(std::ostream &out) : out_(out) {}
+
+    void put(uint64_t value);
+    void putSigned(int64_t value);
+    void putString(const std::string &value);
+
+private:
+    std::ostream &out_;
+};
+
+class CheckpointReader
+{
+public:
+    explicit CheckpointReader(std::istream &in) : in_(in), ok_(true) {}
+
+    uint64_t get();
+    int64_t getSigned();
+    std::string getString();
+    // false once the input ended early, every get after that returns 0
+    bool ok() const { return ok_; }
+
+private:
+    std::istream &in_;
+    bool ok_;
+};
+
+// how far into the trace a checkpoint was taken
+struct TracePosition
+{
+    size_t offset = 0;  // byte offset of the next record
+    size_t line_no = 0; // lines consumed, for error messages
+    size_t accesses = 0, accesses_skip0 = 0;
+    AccessSizeStats sizes; // counted by the Simulator, outside the nodes
+    AtomicStats atomics;
+};
+
+// Snapshot of every cache set, directory line, shared cache, prefetcher and
+// counter plus the placement state, so a warmed up machine can be resumed or
+// forked into variants that keep its geometry. The analysis tools are not
+// saved, their reports only cover the resumed part.
+bool writeCheckpoint(const std::string &path, const RunInfo &info, const std::vector<NUMANode *> &nodes,
+                     const PageMapper *page_mapper, const PageMigrator *migrator, const TracePosition &position);
+// returns an error message, "" on success; nodes must be freshly built
+std::string readCheckpoint(const std::string &path, const RunInfo &info, const std::vector<NUMANode *> &nodes,
+                           PageMapper *page_mapper, PageMigrator *migrator, TracePosition &position);
@@ -0,0 +1,156 @@
+#include <iomanip>
+
+#include "coscheduler.h"
+#include "latencies.h"
+
+const char *interleaveName(Interleave policy)
+{
+    switch (policy)
+    {
+    case Interleave::ROUND_ROBIN:
+        return "round-robin";
+    case Interleave::PROPORTIONAL:
+        return "proportional";
+    case Interleave::TIMESTAMP:
+        return "timestamp";
+    }
+    return "unknown";
+}
+
+CoScheduler::CoScheduler(Interleave policy) : policy_(policy), current_(0), quota_(0), alone_(false) {}
+
+void CoScheduler::addProgram(const std::string &name, RecordSource *source, int first_proc, int procs,
+                             int first_node, int nodes)
+{
+    Program program;
+    program.name = name;
+    program.source = source;
+    program.first_proc = first_proc;
+    program.procs = procs;
+    program.first_node = first_node;
+    program.nodes = nodes;
+    program.asid = programs_.size();
+    program.done = false;
+    program.accesses = 0;
+    program.latency = 0;
+    program.alone_latency = 0;
+    programs_.push_back(program);
+}
+
+int CoScheduler::pick()
+{
+    int programs = (int)programs_.size();
+    if (policy_ == Interleave::TIMESTAMP)
+    {
+        // per proc time, the threads of a program run in parallel
+        int best = -1;
+        for (int i = 0; i < programs; ++i)
+        {
+            const Program &program = programs_[i];
+            if (program.done)
+                continue;
+            if (best < 0 || program.latency * programs_[best].procs < programs_[best].latency * program.procs)
+                best = i;
+        }
+        return best;
+    }
+
+    if (quota_ > 0 && !programs_[current_].done)
+        return current_;
+    for (int i = 1; i <= programs; ++i)
+    {
+        int candidate = (current_ + i) % programs;
+        if (!programs_[candidate].done)
+        {
+            quota_ = policy_ == Interleave::PROPORTIONAL ? programs_[candidate].procs : 1;
+            return candidate;
+        }
+    }
+    return -1;
+}
+
+bool CoScheduler::next(TraceRecord &record)
+{
+    int program_id;
+    while ((program_id = pick()) >= 0)
+    {
+        Program &program = programs_[program_id];
+        current_ = program_id;
+        if (!program.source->next(record))
+        {
+            program.done = true;
+            quota_ = 0;
+            continue;
+        }
+        quota_--;
+        bool fits = record.proc >= 0 && record.proc < program.procs;
+        record.proc = fits ? program.first_proc + record.proc : -1;
+        record.addr |= program.asid << ASID_SHIFT;
+        // the program's memory lives on the nodes it runs on
+        if (record.node_id >= 0)
+            record.node_id = program.first_node + record.node_id % program.nodes;
+        if (record.end_node >= 0)
+            record.end_node = program.first_node + record.end_node % program.nodes;
+        return true;
+    }
+    return false;
+}
+
+size_t CoScheduler::getLineNumber() const
+{
+    return programs_.empty() ? 0 : programs_[current_].source->getLineNumber();
+}
+
+void CoScheduler::charge(size_t latency)
+{
+    Program &program = programs_[current_];
+    if (alone_)
+        program.alone_latency += latency;
+    else
+    {
+        program.accesses++;
+        program.latency += latency;
+    }
+    program.source->charge(latency);
+}
+
+bool CoScheduler::isolate(int program)
+{
+    for (int i = 0; i < (int)programs_.size(); ++i)
+        programs_[i].done = i != program;
+    current_ = program;
+    quota_ = 0;
+    alone_ = true;
+    return programs_[program].source->seek(0, 0);
+}
+
+void CoScheduler::printReport(std::ostream &out) const
+{
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+
+    // slowdown: latency together / latency alone on the same procs
+    double max_slowdown = 0, min_slowdown = 0, weighted_speedup = 0;
+    out << "\t** Co-Scheduling (" << interleaveName(policy_) << ") ***\n\n"
+        << "Program\tProcs\tAccesses\tLatency\tAlone\tSlowdown\n";
+    for (const Program &program : programs_)
+    {
+        double slowdown = program.alone_latency && program.latency
+                              ? (double)program.latency / program.alone_latency
+                              : 1.0;
+        if (max_slowdown == 0 || slowdown > max_slowdown)
+            max_slowdown = slowdown;
+        if (min_slowdown == 0 || slowdown < min_slowdown)
+            min_slowdown = slowdown;
+        weighted_speedup += 1 / slowdown;
+        out << program.name << "\t" << program.first_proc << "-" << program.first_proc + program.procs - 1 << "\t"
+            << program.accesses << "\t\t" << outputLatency(program.latency) << "\t"
+            << outputLatency(program.alone_latency) << "\t" << slowdown << "x\n";
+    }
+    out << "\nWeighted Speedup:\t" << weighted_speedup << "\n"
+        << "Unfairness:\t\t" << (min_slowdown > 0 ? max_slowdown / min_slowdown : 1.0) << "\n"
+        << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "trace_reader.h"
+
+// the order the records of co-scheduled programs reach the machine
+enum class Interleave
+{
+    ROUND_ROBIN,  // one record of every program in turn
+    PROPORTIONAL, // each turn a program issues one record per proc it has
+    TIMESTAMP     // the program furthest behind in simulated time goes next
+};
+
+const char *interleaveName(Interleave policy);
+
+// Runs several traces on one machine at once, like services consolidated on
+// the same sockets. Every program gets a range of procs, its threads are
+// numbered from the first one, its trace's nodes are the nodes of those procs
+// and an address space id in the high address bits keeps the programs from
+// sharing lines.
+class CoScheduler : public RecordSource
+{
+public:
+    // address space ids start at this bit, above the 48 bit user addresses
+    static constexpr int ASID_SHIFT = 48;
+
+    explicit CoScheduler(Interleave policy);
+
+    // the program's threads run on procs first_proc .. first_proc + procs - 1
+    // and its trace node k is homed on node first_node + k % nodes
+    void addProgram(const std::string &name, RecordSource *source, int first_proc, int procs, int first_node,
+                    int nodes);
+    int getPrograms() const { return (int)programs_.size(); }
+
+    // record.proc is the machine-wide thread, -1 if the program has more
+    // threads than procs
+    bool next(TraceRecord &record) override;
+    size_t getLineNumber() const override;
+
+    // several traces cannot be summed up in one position, so co-scheduled
+    // runs are not checkpointed
+    size_t tell() override { return 0; }
+    bool seek(size_t, size_t) override { return false; }
+
+    // every program's latency is needed for its slowdown, and charging the
+    // last record also advances its program in simulated time
+    bool timed() const override { return true; }
+    void charge(size_t latency) override;
+    size_t getAccesses(int program) const { return programs_[program].accesses; }
+
+    // rewinds program and stops scheduling the others, its accesses are then
+    // charged to its latency alone
+    bool isolate(int program);
+
+    void printReport(std::ostream &out) const;
+
+private:
+    struct Program
+    {
+        std::string name;
+        RecordSource *source;
+        int first_proc, procs;
+        int first_node, nodes;
+        size_t asid;
+        bool done;
+        size_t accesses, latency, alone_latency;
+    };
+
+    // the program the next record comes from, -1 once all are done
+    int pick();
+
+    Interleave policy_;
+    std::vector<Program> programs_;
+    int current_;  // the program of the last record
+    int quota_;    // records left in the current turn
+    bool alone_;   // replaying one program after the run
+};
@@ -1,5 +1,7 @@
+#include "checkpoint.h"
 #include "directory.h"
 #include "numa_node.h"
+#include "line_profiler.h"
 
 DirectoryLine *Directory::getLine(size_t addr)
 {
@@ -13,8 +15,56 @@ DirectoryLine *Directory::getLine(size_t addr)
   return it->second;
 }
 
+const DirectoryLine *Directory::findLine(size_t addr) const
+{
+  auto it = directory_.find(addr & ~((size_t)(1 << block_offset_bits_) - 1));
+  return it == directory_.end() ? nullptr : it->second;
+}
+
 size_t Directory::getAddr(size_t address) { return address & ~((size_t)(1 << block_offset_bits_) - 1); }
 
+void Directory::save(CheckpointWriter &out) const
+{
+  out.put(memory_reads_);
+  out.put(directory_.size());
+  // the map is sorted, so line addresses are stored as small deltas
+  size_t last = 0;
+  for (const auto &[addr, line] : directory_)
+  {
+    out.put(addr - last);
+    last = addr;
+    out.put((uint64_t)line->state_);
+    out.putSigned(line->owner_);
+    for (int first = 0; first < procs_; first += 64)
+    {
+      uint64_t bits = 0;
+      for (int proc = first; proc < std::min(procs_, first + 64); ++proc)
+        bits |= (uint64_t)line->presence_[proc] << (proc - first);
+      out.put(bits);
+    }
+  }
+}
+
+void Directory::load(CheckpointReader &in)
+{
+  memory_reads_ = in.get();
+  size_t lines = in.get();
+  size_t addr = 0;
+  for (size_t i = 0; i < lines && in.ok(); ++i)
+  {
+    addr += in.get();
+    DirectoryLine *line = getLine(addr);
+    line->state_ = (DirectoryState)in.get();
+    line->owner_ = in.getSigned();
+    for (int first = 0; first < procs_; first += 64)
+    {
+      uint64_t bits = in.get();
+      for (int proc = first; proc < std::min(procs_, first + 64); ++proc)
+        line->presence_[proc] = (bits >> (proc - first)) & 1;
+    }
+  }
+}
+
 void Directory::assignToNode(NUMANode *node) { numa_node_ = node; }
 
 void Directory::receiveMsg(int cache_id, size_t address, CacheMsg msg_type, bool is_dirty)
@@ -37,6 +87,9 @@ void Directory::receiveMsg(int cache_id, size_t address, CacheMsg msg_type, bool
   case CacheMsg::BROADCAST:
     receiveBroadcast(cache_id, addr);
     break;
+  case CacheMsg::NACK:
+    receiveNack(cache_id, addr);
+    break;
   case CacheMsg::NOP:
     break;
   }
@@ -55,6 +108,14 @@ void Directory::invalidateSharers(DirectoryLine *line, int new_owner, size_t add
   }
 }
 
+// exclusive ownership moving between caches is what makes a line contended
+void Directory::setOwner(DirectoryLine *line, int owner, size_t addr)
+{
+  if (profiler_ && line->owner_ != -1 && line->owner_ != owner)
+    profiler_->record(addr, numa_node_->getID(), LineEvent::OWNERSHIP_TRANSFER);
+  line->owner_ = owner;
+}
+
 void Directory::receiveData(int cache_id, size_t addr, bool is_dirty)
 {
   DirectoryLine *line = getLine(addr);
@@ -71,7 +132,18 @@ void Directory::receiveBroadcast(int cache_id, size_t addr)
   for (size_t i = 0; i < line->presence_.size(); ++i)
     if (line->presence_[i] && i != (size_t)cache_id)
       numa_node_->emitDirectoryMsg(i, addr, DirectoryMsg::READDATA);
-  line->owner_ = cache_id;
+  setOwner(line, cache_id, addr);
+}
+
+// the fetched cache dropped its clean copy silently, memory supplies the line
+// and the request that sent the fetch settles the state
+void Directory::receiveNack(int cache_id, size_t addr)
+{
+  DirectoryLine *line = getLine(addr);
+  memory_reads_ += 1;
+  line->presence_[cache_id] = false;
+  if (line->owner_ == cache_id)
+    line->owner_ = -1;
 }
 
 void Directory::receiveEviction(int cache_id, size_t addr)
@@ -98,9 +170,45 @@ void Directory::receiveEviction(int cache_id, size_t addr)
   }
 }
 
+size_t Directory::flushRange(size_t start, size_t end)
+{
+  size_t lines = 0;
+  auto it = directory_.lower_bound(start);
+  while (it != directory_.end() && it->first < end)
+  {
+    size_t addr = it->first;
+    DirectoryLine *line = it->second;
+    bool dirty_owner = line->state_ == DirectoryState::EM || protocol_ == Protocol::MOESI;
+    if (dirty_owner && line->owner_ != -1 && line->presence_[line->owner_])
+      numa_node_->emitDirectoryMsg(line->owner_, addr, DirectoryMsg::FETCH, numa_node_->getID());
+    for (size_t i = 0; i < line->presence_.size(); ++i)
+    {
+      if (line->presence_[i])
+        numa_node_->emitDirectoryMsg(i, addr, DirectoryMsg::INVALIDATE);
+    }
+    delete line;
+    it = directory_.erase(it);
+    lines += 1;
+  }
+  return lines;
+}
+
+bool Directory::addSharer(int cache_id, size_t addr)
+{
+  DirectoryLine *line = getLine(getAddr(addr));
+  if (line->state_ == DirectoryState::EM)
+    return false;
+  line->state_ = DirectoryState::SO;
+  line->presence_[cache_id] = true;
+  return true;
+}
+
 void Directory::receiveBusRd(int cache_id, size_t addr)
 {
   DirectoryLine *line = getLine(addr);
+  // a cache only reads lines it misses, so it dropped this one silently
+  if (line->presence_[cache_id])
+    receiveEviction(cache_id, addr);
 
   switch (line->state_)
   {
@@ -112,7 +220,8 @@ void Directory::receiveBusRd(int cache_id, size_t addr)
                                               : DirectoryState::EM;
     break;
   case DirectoryState::SO:
-    if (protocol_ == Protocol::MOESI && line->owner_ != -1)
+    // the owner (MOESI) or forwarder (MESIF) supplies the line instead of memory
+    if ((protocol_ == Protocol::MOESI || protocol_ == Protocol::MESIF) && line->owner_ != -1)
       numa_node_->emitDirectoryMsg(line->owner_, addr, DirectoryMsg::FETCH, numa_node_->getID());
     else
       memory_reads_ += 1;
@@ -120,16 +229,29 @@ void Directory::receiveBusRd(int cache_id, size_t addr)
     break;
   case DirectoryState::EM:
     numa_node_->emitDirectoryMsg(line->owner_, addr, DirectoryMsg::FETCH, numa_node_->getID());
+    if (line->owner_ == -1 && std::count(line->presence_.begin(), line->presence_.end(), true) == 0)
+    {
+      // the exclusive copy was gone, the reader becomes the only holder
+      numa_node_->emitDirectoryMsg(cache_id, addr, DirectoryMsg::READDATA_EX);
+      line->owner_ = cache_id;
+      break;
+    }
     numa_node_->emitDirectoryMsg(cache_id, addr, DirectoryMsg::READDATA);
     line->state_ = DirectoryState::SO;
     break;
   }
   line->presence_[cache_id] = true;
+  // the newest sharer becomes the forwarder
+  if (protocol_ == Protocol::MESIF && line->state_ == DirectoryState::SO)
+    line->owner_ = cache_id;
 }
 
 void Directory::receiveBusRdX(int cache_id, size_t addr)
 {
   DirectoryLine *line = getLine(addr);
+  // an exclusive holder writes without asking, so it dropped this one silently
+  if (line->state_ == DirectoryState::EM && line->owner_ == cache_id)
+    receiveEviction(cache_id, addr);
 
   switch (line->state_)
   {
@@ -138,14 +260,19 @@ void Directory::receiveBusRdX(int cache_id, size_t addr)
     numa_node_->emitDirectoryMsg(cache_id, addr, DirectoryMsg::WRITEDATA);
     break;
   case DirectoryState::SO:
+    // a forwarder other than the writer supplies the line before it is invalidated
+    if (protocol_ == Protocol::MESIF && line->owner_ != -1 && line->owner_ != cache_id)
+      numa_node_->emitDirectoryMsg(line->owner_, addr, DirectoryMsg::FETCH, numa_node_->getID());
+    else
+      memory_reads_ += 1;
     invalidateSharers(line, cache_id, addr);
-    memory_reads_ += 1;
     numa_node_->emitDirectoryMsg(cache_id, addr, DirectoryMsg::WRITEDATA);
     break;
   case DirectoryState::EM:
     int owner_id = line->owner_;
     numa_node_->emitDirectoryMsg(owner_id, addr, DirectoryMsg::FETCH, numa_node_->getID());
-    numa_node_->emitDirectoryMsg(owner_id, addr, DirectoryMsg::INVALIDATE);
+    if (line->presence_[owner_id])
+      numa_node_->emitDirectoryMsg(owner_id, addr, DirectoryMsg::INVALIDATE);
     line->presence_[owner_id] = false;
 
     numa_node_->emitDirectoryMsg(cache_id, addr, DirectoryMsg::WRITEDATA);
@@ -153,5 +280,5 @@ void Directory::receiveBusRdX(int cache_id, size_t addr)
   }
   line->presence_[cache_id] = true;
   line->state_ = DirectoryState::EM;
-  line->owner_ = cache_id;
+  setOwner(line, cache_id, addr);
 }
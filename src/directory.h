@@ -6,6 +6,9 @@
 #include "cache.h"
 
 class NUMANode;
+class LineProfiler;
+class CheckpointWriter;
+class CheckpointReader;
 
 enum class DirectoryState
 {
@@ -32,7 +35,8 @@ public:
         : procs_(procs),
           block_offset_bits_(b),
           protocol_(protocol),
-          memory_reads_(0) {}
+          memory_reads_(0),
+          profiler_(nullptr) {}
     ~Directory()
     {
         for (auto &[addr, line] : directory_)
@@ -51,13 +55,29 @@ public:
     void receiveEviction(int cache_id, size_t addr);
     void receiveData(int cache_id, size_t addr, bool is_dirty);
     void receiveBroadcast(int cache_id, size_t addr);
+    void receiveNack(int cache_id, size_t addr);
+
+    // drops every line in [start, end): owners send their data home and all
+    // copies are invalidated, returns the number of lines dropped
+    size_t flushRange(size_t start, size_t end);
+    // records a read served by the requester's node from a shared cache,
+    // false if a cache holds the line exclusively and has to be asked
+    bool addSharer(int cache_id, size_t addr);
+
+    // every line ever requested, restored into an empty directory
+    void save(CheckpointWriter &out) const;
+    void load(CheckpointReader &in);
 
     size_t getMemoryReads() const { return memory_reads_; }
+    // nullptr if the line has never been requested
+    const DirectoryLine *findLine(size_t addr) const;
+    void attachProfiler(LineProfiler *profiler) { profiler_ = profiler; }
 
 private:
     size_t getAddr(size_t addr);
     DirectoryLine *getLine(size_t addr);
     void invalidateSharers(DirectoryLine *line, int new_owner, size_t addr);
+    void setOwner(DirectoryLine *line, int owner, size_t addr);
 
     int procs_;
     int block_offset_bits_;
@@ -66,4 +86,5 @@ private:
     std::map<size_t, DirectoryLine *> directory_;
 
     NUMANode *numa_node_;
+    LineProfiler *profiler_;
 };
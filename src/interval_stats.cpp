@@ -0,0 +1,76 @@
+#include "interval_stats.h"
+
+NodeStats snapshotStats(const std::vector<NUMANode *> &nodes)
+{
+    NodeStats stats;
+    for (NUMANode *node : nodes)
+        stats += node->getStats(false);
+    return stats;
+}
+
+IntervalRecorder::IntervalRecorder(std::ostream &out, size_t length, IntervalUnit unit)
+    : out_(out),
+      length_(length),
+      unit_(unit),
+      intervals_(0),
+      next_boundary_(length),
+      last_accesses_(0)
+{
+    out_ << "interval,end_access,end_ns,accesses,ns,hits,misses,invalidations,global_events,memory_reads\n";
+}
+
+void IntervalRecorder::record(const std::vector<NUMANode *> &nodes, size_t accesses)
+{
+    if (unit_ == IntervalUnit::ACCESSES)
+    {
+        // no need to touch any counters until the interval is over
+        if (accesses < next_boundary_)
+            return;
+        writeRow(snapshotStats(nodes), accesses);
+        // a run of the same access can span several intervals
+        while (next_boundary_ <= accesses)
+            next_boundary_ += length_;
+        return;
+    }
+
+    NodeStats now = snapshotStats(nodes);
+    size_t ns = now.latency();
+    if (ns < next_boundary_)
+        return;
+    writeRow(now, accesses);
+    // a single slow access can span several intervals
+    while (next_boundary_ <= ns)
+        next_boundary_ += length_;
+}
+
+void IntervalRecorder::resume(const std::vector<NUMANode *> &nodes, size_t accesses)
+{
+    last_ = snapshotStats(nodes);
+    last_accesses_ = accesses;
+    size_t position = unit_ == IntervalUnit::ACCESSES ? accesses : last_.latency();
+    intervals_ = position / length_;
+    next_boundary_ = (intervals_ + 1) * length_;
+}
+
+void IntervalRecorder::finish(const std::vector<NUMANode *> &nodes, size_t accesses)
+{
+    if (accesses > last_accesses_)
+        writeRow(snapshotStats(nodes), accesses);
+    out_.flush();
+}
+
+void IntervalRecorder::writeRow(const NodeStats &now, size_t accesses)
+{
+    out_ << intervals_++ << ","
+         << accesses << ","
+         << now.latency() << ","
+         << accesses - last_accesses_ << ","
+         << now.latency() - last_.latency() << ","
+         << now.hits_ - last_.hits_ << ","
+         << now.misses_ - last_.misses_ << ","
+         << now.invalidations_ - last_.invalidations_ << ","
+         << now.global_events_ - last_.global_events_ << ","
+         << now.memory_reads_ - last_.memory_reads_ << "\n";
+    last_ = now;
+    last_accesses_ = accesses;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <ostream>
+#include <vector>
+
+#include "numa_node.h"
+
+// what an interval length is measured in
+enum class IntervalUnit
+{
+    ACCESSES,
+    NANOSECONDS
+};
+
+// Writes the change in the machine counters every interval as one csv row, so
+// the startup, contention and drain phases of a run can be told apart.
+class IntervalRecorder
+{
+public:
+    IntervalRecorder(std::ostream &out, size_t length, IntervalUnit unit);
+
+    // called after every access with the number of accesses so far
+    void record(const std::vector<NUMANode *> &nodes, size_t accesses);
+    // continue the intervals of a run restored from a checkpoint
+    void resume(const std::vector<NUMANode *> &nodes, size_t accesses);
+    // writes whatever is left of the last interval
+    void finish(const std::vector<NUMANode *> &nodes, size_t accesses);
+
+private:
+    void writeRow(const NodeStats &now, size_t accesses);
+
+    std::ostream &out_;
+    size_t length_;
+    IntervalUnit unit_;
+
+    size_t intervals_;
+    size_t next_boundary_;
+    size_t last_accesses_;
+    NodeStats last_;
+};
+
+// O(caches) sum of the O(1) per-cache and per-node counters
+NodeStats snapshotStats(const std::vector<NUMANode *> &nodes);
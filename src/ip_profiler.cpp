@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ip_profiler.h"
+
+IpProfiler::IpProfiler(const std::string &binary, size_t load_base)
+    : binary_(binary),
+      load_base_(load_base) {}
+
+void IpProfiler::recordAccess(size_t ip, const NodeStats &before, const NodeStats &after, bool remote,
+                              size_t accesses)
+{
+    IpStats &stats = ips_[ip];
+    stats.ip = ip;
+    stats.accesses += accesses;
+    stats.misses += after.misses_ - before.misses_;
+    stats.invalidations += after.invalidations_ - before.invalidations_;
+    stats.global_events += after.global_events_ - before.global_events_;
+    stats.remote_accesses += remote * accesses;
+    stats.latency += after.latency() - before.latency();
+}
+
+// one addr2line process for the whole report, returns "" for every ip if it
+// cannot be run
+std::vector<std::string> IpProfiler::symbolize(const std::vector<IpStats> &ips) const
+{
+    std::vector<std::string> symbols(ips.size());
+    if (binary_ == "" || ips.empty())
+        return symbols;
+
+    // accesses without an ip are reported as unknown. The binary is passed
+    // as its own argument, no shell sees its name
+    std::vector<size_t> known;
+    std::vector<std::string> args = {"addr2line", "-f", "-C", "-e", binary_};
+    for (size_t i = 0; i < ips.size(); ++i)
+    {
+        if (ips[i].ip == 0)
+            continue;
+        known.push_back(i);
+        std::ostringstream addr;
+        addr << "0x" << std::hex << ips[i].ip - load_base_;
+        args.push_back(addr.str());
+    }
+    if (known.empty())
+        return symbols;
+    std::vector<char *> argv;
+    for (std::string &arg : args)
+        argv.push_back(arg.data());
+    argv.push_back(nullptr);
+
+    int fds[2];
+    if (::pipe(fds) != 0)
+        return symbols;
+    pid_t child = fork();
+    if (child < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return symbols;
+    }
+    if (child == 0)
+    {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    close(fds[1]);
+    FILE *pipe = fdopen(fds[0], "r");
+    if (pipe == nullptr)
+    {
+        close(fds[0]);
+        waitpid(child, nullptr, 0);
+        return symbols;
+    }
+
+    // addr2line -f prints the function and file:line on separate lines
+    char function[1024], location[1024];
+    for (size_t i : known)
+    {
+        if (!fgets(function, sizeof(function), pipe) || !fgets(location, sizeof(location), pipe))
+            break;
+        function[strcspn(function, "\n")] = '\0';
+        location[strcspn(location, "\n")] = '\0';
+        symbols[i] = std::string(function) + " " + location;
+    }
+    fclose(pipe);
+    waitpid(child, nullptr, 0);
+    return symbols;
+}
+
+void IpProfiler::printReport(std::ostream &out, size_t k) const
+{
+    std::vector<IpStats> ranked;
+    for (const auto &[ip, stats] : ips_)
+        ranked.push_back(stats);
+    k = std::min(k, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + k, ranked.end(),
+                      [](const IpStats &a, const IpStats &b)
+                      { return a.latency > b.latency; });
+    ranked.resize(k);
+    std::vector<std::string> symbols = symbolize(ranked);
+
+    out << "\t** Top " << k << " Instructions By Modeled Latency ***\n\n";
+    out << std::left << std::setw(20) << "IP" << std::setw(12) << "Accesses" << std::setw(10) << "Misses"
+        << std::setw(10) << "Inval" << std::setw(10) << "Remote" << std::setw(10) << "Global"
+        << std::setw(12) << "Latency" << "Location\n";
+    for (size_t i = 0; i < k; ++i)
+    {
+        const IpStats &stats = ranked[i];
+        std::ostringstream ip;
+        if (stats.ip == 0)
+            ip << "unknown";
+        else
+            ip << "0x" << std::hex << stats.ip;
+        out << std::setw(20) << ip.str() << std::setw(12) << stats.accesses << std::setw(10) << stats.misses
+            << std::setw(10) << stats.invalidations << std::setw(10) << stats.remote_accesses
+            << std::setw(10) << stats.global_events << std::setw(12) << outputLatency(stats.latency)
+            << symbols[i] << "\n";
+    }
+    out << std::right << std::endl;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "numa_node.h"
+
+struct IpStats
+{
+    size_t ip = 0;
+    size_t accesses = 0, misses = 0, invalidations = 0, remote_accesses = 0, global_events = 0;
+    size_t latency = 0; // modeled ns, including the work the access caused in other caches
+};
+
+// Attributes the cost of every access to the instruction that issued it, by
+// taking the change in the machine counters across the access.
+class IpProfiler
+{
+public:
+    // binary and load_base are used to symbolize the report with addr2line
+    IpProfiler(const std::string &binary, size_t load_base);
+
+    // accesses > 1 for a run of the same access
+    void recordAccess(size_t ip, const NodeStats &before, const NodeStats &after, bool remote, size_t accesses = 1);
+    void printReport(std::ostream &out, size_t k) const;
+
+private:
+    std::vector<std::string> symbolize(const std::vector<IpStats> &ips) const;
+
+    std::string binary_;
+    size_t load_base_;
+    std::unordered_map<size_t, IpStats> ips_;
+};
@@ -8,6 +8,9 @@ static const int NUMA_DISTANCE = 2;
 // L1 cache hit time
 static const int CACHE_LATENCY = 1;
 
+// work between two accesses, per instruction
+static const int INSTRUCTION_LATENCY = 1;
+
 // main memory read/write time
 static const int MEMORY_LATENCY = 100;
 
@@ -17,4 +20,7 @@ static const int LOCAL_INTERCONNECT_LATENCY = 1;
 // NUMA node -> NUMA node latency
 static constexpr int GLOBAL_INTERCONNECT_LATENCY = LOCAL_INTERCONNECT_LATENCY * NUMA_DISTANCE;
 
+// interrupting every other processor to drop a stale translation
+static const int TLB_SHOOTDOWN_LATENCY = 4000;
+
 std::string outputLatency(size_t x);
\ No newline at end of file
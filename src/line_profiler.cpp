@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "line_profiler.h"
+#include "numa_node.h"
+
+LineProfiler::LineProfiler(size_t capacity, int offset_len)
+    : capacity_(capacity),
+      offset_len_(offset_len),
+      total_events_(0)
+{
+    heap_.reserve(capacity_);
+    index_.reserve(capacity_);
+}
+
+void LineProfiler::swapEntries(size_t a, size_t b)
+{
+    std::swap(heap_[a], heap_[b]);
+    index_[heap_[a].addr] = a;
+    index_[heap_[b].addr] = b;
+}
+
+// counts only ever grow, so an entry can only need to move down
+void LineProfiler::siftDown(size_t pos)
+{
+    while (true)
+    {
+        size_t smallest = pos;
+        size_t left = 2 * pos + 1, right = 2 * pos + 2;
+        if (left < heap_.size() && heap_[left].count < heap_[smallest].count)
+            smallest = left;
+        if (right < heap_.size() && heap_[right].count < heap_[smallest].count)
+            smallest = right;
+        if (smallest == pos)
+            return;
+        swapEntries(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void LineProfiler::record(size_t addr, int home, LineEvent event)
+{
+    size_t line = addr & ~(((size_t)1 << offset_len_) - 1);
+    total_events_ += 1;
+
+    size_t pos;
+    auto it = index_.find(line);
+    if (it != index_.end())
+    {
+        pos = it->second;
+    }
+    else if (heap_.size() < capacity_)
+    {
+        // new entries have the lowest possible count so they go on top
+        heap_.push_back(HotLine());
+        pos = heap_.size() - 1;
+        while (pos > 0 && heap_[(pos - 1) / 2].count > 0)
+        {
+            heap_[pos] = heap_[(pos - 1) / 2];
+            index_[heap_[pos].addr] = pos;
+            pos = (pos - 1) / 2;
+        }
+        heap_[pos] = HotLine();
+        heap_[pos].addr = line;
+        index_[line] = pos;
+    }
+    else
+    {
+        // replace the minimum, the newcomer may have been evicted before
+        pos = 0;
+        index_.erase(heap_[0].addr);
+        size_t min_count = heap_[0].count;
+        heap_[0] = HotLine();
+        heap_[0].addr = line;
+        heap_[0].count = min_count;
+        heap_[0].error = min_count;
+        index_[line] = 0;
+    }
+
+    HotLine &entry = heap_[pos];
+    entry.home = home;
+    entry.count += 1;
+    switch (event)
+    {
+    case LineEvent::INVALIDATION:
+        entry.invalidations += 1;
+        break;
+    case LineEvent::OWNERSHIP_TRANSFER:
+        entry.ownership_transfers += 1;
+        break;
+    case LineEvent::FETCH:
+        entry.fetches += 1;
+        break;
+    case LineEvent::GLOBAL:
+        entry.global_events += 1;
+        break;
+    }
+    siftDown(pos);
+}
+
+std::vector<HotLine> LineProfiler::top(size_t k) const
+{
+    std::vector<HotLine> lines = heap_;
+    k = std::min(k, lines.size());
+    std::partial_sort(lines.begin(), lines.begin() + k, lines.end(),
+                      [](const HotLine &a, const HotLine &b)
+                      { return a.count > b.count; });
+    lines.resize(k);
+    return lines;
+}
+
+void LineProfiler::printReport(std::ostream &out, size_t k, const std::vector<NUMANode *> &nodes) const
+{
+    out << "\t** Top " << k << " Contended Lines ***\n\n"
+        << "Tracked Events:\t\t" << total_events_ << "\n"
+        << "Sketch Capacity:\t" << capacity_ << "\n\n";
+
+    out << std::left << std::setw(20) << "Line" << std::setw(6) << "Home" << std::setw(10) << "Events"
+        << std::setw(10) << "Error" << std::setw(8) << "Inval" << std::setw(8) << "Owner"
+        << std::setw(8) << "Fetch" << std::setw(8) << "Global"
+        << "State/Sharers\n";
+
+    for (const HotLine &line : top(k))
+    {
+        std::ostringstream addr;
+        addr << "0x" << std::hex << line.addr;
+        out << std::setw(20) << addr.str() << std::setw(6) << line.home << std::setw(10) << line.count
+            << std::setw(10) << line.error << std::setw(8) << line.invalidations
+            << std::setw(8) << line.ownership_transfers << std::setw(8) << line.fetches
+            << std::setw(8) << line.global_events;
+
+        const DirectoryLine *dir_line = nullptr;
+        if (line.home >= 0 && line.home < (int)nodes.size())
+            dir_line = nodes[line.home]->getDirectory()->findLine(line.addr);
+        if (dir_line == nullptr)
+        {
+            out << "U {}\n";
+            continue;
+        }
+
+        switch (dir_line->state_)
+        {
+        case DirectoryState::U:
+            out << "U";
+            break;
+        case DirectoryState::SO:
+            out << "SO";
+            break;
+        case DirectoryState::EM:
+            out << "EM";
+            break;
+        }
+        out << " {";
+        bool first = true;
+        for (size_t i = 0; i < dir_line->presence_.size(); ++i)
+        {
+            if (!dir_line->presence_[i])
+                continue;
+            out << (first ? "" : ",") << i << ((int)i == dir_line->owner_ ? "*" : "");
+            first = false;
+        }
+        out << "}\n";
+    }
+    out << std::right << std::endl;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+
+class NUMANode;
+
+enum class LineEvent
+{
+    INVALIDATION,
+    OWNERSHIP_TRANSFER,
+    FETCH,
+    GLOBAL,
+};
+
+struct HotLine
+{
+    size_t addr = 0;
+    int home = -1;
+    // space-saving count and the most it can overestimate the true count by
+    size_t count = 0;
+    size_t error = 0;
+    // breakdown of events seen since the line was last (re)admitted
+    size_t invalidations = 0, ownership_transfers = 0, fetches = 0, global_events = 0;
+};
+
+// Finds the most contended cache lines with bounded memory using the
+// space-saving algorithm: at most capacity lines are tracked and a new line
+// replaces the one with the lowest count, inheriting that count as its error.
+class LineProfiler
+{
+public:
+    LineProfiler(size_t capacity, int offset_len);
+
+    void record(size_t addr, int home, LineEvent event);
+
+    // the k lines with the highest counts, highest first
+    std::vector<HotLine> top(size_t k) const;
+    void printReport(std::ostream &out, size_t k, const std::vector<NUMANode *> &nodes) const;
+
+private:
+    void siftDown(size_t pos);
+    void swapEntries(size_t a, size_t b);
+
+    size_t capacity_;
+    int offset_len_;
+    size_t total_events_;
+
+    // min-heap on count, index_ maps a line to its position in the heap
+    std::vector<HotLine> heap_;
+    std::unordered_map<size_t, size_t> index_;
+};
@@ -0,0 +1,49 @@
+#include <algorithm>
+
+#include "machine.h"
+
+int procToNode(int proc, int num_procs, int numa_nodes)
+{
+    // the first num_procs % numa_nodes nodes get one proc more
+    int per_node = num_procs / numa_nodes;
+    int larger = num_procs % numa_nodes;
+    int split = larger * (per_node + 1);
+    if (proc < split)
+        return proc / (per_node + 1);
+    return larger + (proc - split) / per_node;
+}
+
+int firstProcOfNode(int node, int num_procs, int numa_nodes)
+{
+    return node * (num_procs / numa_nodes) + std::min(node, num_procs % numa_nodes);
+}
+
+void setupInterconnects(std::vector<NUMANode *> &nodes)
+{
+    for (NUMANode *node : nodes)
+    {
+        for (NUMANode *node1 : nodes)
+        {
+            node1->connectWith(node, node->getID());
+        }
+    }
+}
+
+NUMANode *NewNumaNode(int num_procs, int num_nodes, int node_id, int index_len, int ways, int offset_len, Protocol protocol)
+{
+    std::vector<Cache *> caches;
+    int end = firstProcOfNode(node_id + 1, num_procs, num_nodes);
+    for (int cache_id = firstProcOfNode(node_id, num_procs, num_nodes); cache_id < end; ++cache_id)
+        caches.push_back(new Cache(cache_id, index_len, ways, offset_len, protocol));
+    Directory *dir = new Directory(num_procs, offset_len, protocol);
+    return new NUMANode(node_id, num_nodes, num_procs, dir, caches);
+}
+
+std::vector<NUMANode *> NewMachine(int num_procs, int num_nodes, int index_len, int ways, int offset_len, Protocol protocol)
+{
+    std::vector<NUMANode *> nodes;
+    for (int i = 0; i < num_nodes; ++i)
+        nodes.push_back(NewNumaNode(num_procs, num_nodes, i, index_len, ways, offset_len, protocol));
+    setupInterconnects(nodes);
+    return nodes;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+
+#include "numa_node.h"
+
+// returns the NUMA node proc is on, procs are numbered node by node and
+// when they do not divide evenly the first nodes get one more
+int procToNode(int proc, int num_procs, int numa_nodes);
+int firstProcOfNode(int node, int num_procs, int numa_nodes);
+
+// connect all of the NUMA regions interconnects, so node1->interconnect_[i] ==
+// node->interconnect_[i]
+void setupInterconnects(std::vector<NUMANode *> &nodes);
+
+NUMANode *NewNumaNode(int num_procs, int num_nodes, int node_id, int index_len, int ways, int offset_len, Protocol protocol);
+
+// all nodes of a machine, already connected with each other
+std::vector<NUMANode *> NewMachine(int num_procs, int num_nodes, int index_len, int ways, int offset_len, Protocol protocol);
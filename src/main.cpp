@@ -1,27 +1,130 @@
 #include <getopt.h>
+#include <ctime>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 #include "numa_node.h"
+#include "machine.h"
 #include "latencies.h"
+#include "results_writer.h"
+#include "interval_stats.h"
+#include "line_profiler.h"
+#include "sharing_analyzer.h"
+#include "ip_profiler.h"
+#include "trace_reader.h"
+#include "traffic_matrix.h"
+#include "self_profile.h"
+#include "page_mapper.h"
+#include "page_migrator.h"
+#include "checkpoint.h"
+#include "workload_gen.h"
+#include "affinity.h"
+#include "coscheduler.h"
+#include "trace_merge.h"
+#include "numasim.h"
 
-// returns the NUMA node proc is on
-int procToNode(int proc, int num_procs, int numa_nodes) { return proc / (num_procs / numa_nodes); }
+// long options without a short form
+enum LongOption
+{
+  OPT_INTERVAL = 256,
+  OPT_INTERVAL_NS,
+  OPT_INTERVAL_FILE,
+  OPT_HOT_LINES,
+  OPT_HOT_LINES_CAPACITY,
+  OPT_FALSE_SHARING,
+  OPT_ACCESS_SIZE,
+  OPT_IP_PROFILE,
+  OPT_IP_BINARY,
+  OPT_IP_BASE,
+  OPT_TRAFFIC,
+  OPT_SELF_PROFILE,
+  OPT_PERF_COUNTERS,
+  OPT_SNOOP,
+  OPT_SILENT_EVICTIONS,
+  OPT_PREFETCH,
+  OPT_PREFETCH_DEGREE,
+  OPT_PLACEMENT,
+  OPT_PAGE_SIZE,
+  OPT_PREFERRED_NODE,
+  OPT_MIGRATE,
+  OPT_MIGRATE_THRESHOLD,
+  OPT_MIGRATE_SAMPLE,
+  OPT_REPLICATE,
+  OPT_LLC,
+  OPT_LLC_SETS,
+  OPT_LLC_WAYS,
+  OPT_REMOTE_CACHE,
+  OPT_REMOTE_CACHE_SETS,
+  OPT_REMOTE_CACHE_WAYS,
+  OPT_CHECKPOINT,
+  OPT_CHECKPOINT_EVERY,
+  OPT_STOP_AFTER,
+  OPT_RESTORE,
+  OPT_GEN_ACCESSES,
+  OPT_GEN_LINES,
+  OPT_GEN_WRITES,
+  OPT_GEN_ZIPF,
+  OPT_GEN_SEED,
+  OPT_AFFINITY,
+  OPT_AFFINITY_MAP,
+  OPT_CO_PROCS,
+  OPT_INTERLEAVE,
+  OPT_MERGE,
+  OPT_MERGE_WINDOW,
+};
 
-// connect all of the NUMA regions interconnects, so node1->interconnect_[i] ==
-// node->interconnect_[i]
-void setupInterconnects(std::vector<NUMANode *> &nodes)
+struct SimOptions
 {
-  for (NUMANode *node : nodes)
-  {
-    for (NUMANode *node1 : nodes)
-    {
-      node1->connectWith(node, node->getID());
-    }
-  }
-}
+  SimulatorConfig machine;
+  std::string protocol_name = "MOESI";
+  std::string affinity_map;
+
+  bool aggregate = false;
+  bool aggr_skip0 = false;
+  bool individual = false;
+
+  OutputFormat format = OutputFormat::TEXT;
+  std::string output_path; // empty means stdout
+  RunInfo info;
+
+  size_t interval = 0; // 0 disables interval stats
+  IntervalUnit interval_unit = IntervalUnit::ACCESSES;
+  std::string interval_path = "intervals.csv";
 
-void printAggregateStats(std::vector<NUMANode *> &nodes, int total_events, bool skip0)
+  size_t hot_lines = 0; // 0 disables the contention profiler
+  size_t hot_lines_capacity = 4096;
+
+  size_t false_sharing = 0; // 0 disables the sharing analysis
+  int access_size = 4;      // of accesses without sz=, for the sharing analysis
+
+  size_t ip_profile = 0; // 0 disables per instruction attribution
+  std::string ip_binary;
+  size_t ip_base = 0;
+
+  std::string traffic_path; // empty disables the traffic matrix
+
+  bool self_profile = false;
+  bool perf_counters = false;
+
+  std::string checkpoint_path; // empty disables checkpoints
+  size_t checkpoint_every = 0; // 0 only writes one when the run ends
+  size_t stop_after = 0;       // 0 runs the whole trace
+  std::string restore_path;
+
+  bool generate = false; // -g replaces the trace file
+  GeneratorConfig generator;
+
+  std::vector<int> co_procs; // procs of every trace when several are given
+  Interleave interleave = Interleave::ROUND_ROBIN;
+
+  bool merge = false; // false keeps the order of the records in the trace
+  MergeOrder merge_order = MergeOrder::TIMESTAMP;
+  size_t merge_window = 1 << 20; // records read ahead at most
+};
+
+void printAggregateStats(const std::vector<NUMANode *> &nodes, size_t total_events, bool skip0)
 {
   NodeStats stats;
   for (NUMANode *node : nodes)
@@ -80,113 +183,721 @@ void printAggregateStats(std::vector<NUMANode *> &nodes, int total_events, bool
             << std::endl;
 }
 
-NUMANode *NewNumaNode(int num_procs, int num_nodes, int node_id, int index_len, int ways, int offset_len, Protocol protocol)
+void printSnoopStats(std::ostream &out, const std::vector<NUMANode *> &nodes)
 {
-  int procs_per_node = num_procs / num_nodes;
-  std::vector<Cache *> caches;
-  for (int i = 0; i < procs_per_node; ++i)
+  size_t snoop_events = 0, directory_events = 0, global_events = 0;
+  for (const NUMANode *node : nodes)
   {
-    int cache_id = procs_per_node * node_id + i;
-    caches.push_back(new Cache(cache_id, index_len, ways, offset_len, protocol));
+    snoop_events += node->getSnoopEvents();
+    directory_events += node->getDirectoryLocalEvents();
+    global_events += node->getGlobalEvents();
   }
-  Directory *dir = new Directory(num_procs, offset_len, protocol);
-  return new NUMANode(node_id, num_nodes, num_procs, dir, caches);
+  size_t snoop_latency = snoop_events * LOCAL_INTERCONNECT_LATENCY;
+  size_t directory_latency = directory_events * LOCAL_INTERCONNECT_LATENCY;
+
+  out << "\t** Hierarchical Coherence ***\n\n"
+      << "Intra-node Snoop Events:\t" << snoop_events << "\n"
+      << "Inter-node Global Events:\t" << global_events << "\n"
+      << "Flat Directory Local Events:\t" << directory_events << "\n"
+      << "Intra-node Latency:\t\t" << outputLatency(snoop_latency) << "\n"
+      << "Inter-node Latency:\t\t" << outputLatency(global_events * GLOBAL_INTERCONNECT_LATENCY) << "\n"
+      << "Flat Directory Local Latency:\t" << outputLatency(directory_latency) << "\n"
+      << "Latency Saved By Snooping:\t"
+      << (snoop_latency > directory_latency ? "-" + outputLatency(snoop_latency - directory_latency)
+                                            : outputLatency(directory_latency - snoop_latency))
+      << "\n"
+      << std::endl;
 }
 
-void runSimulation(int s, int E, int b, std::ifstream &trace, int procs, int numa_nodes, Protocol protocol, bool individual, bool aggregate, bool aggr_skip0)
+void printSilentEvictionStats(std::ostream &out, const std::vector<NUMANode *> &nodes)
 {
-  std::vector<NUMANode *> nodes;
-  for (int i = 0; i < numa_nodes; ++i)
+  CacheStats stats;
+  for (const NUMANode *node : nodes)
+    for (const Cache *cache : node->getCaches())
+    {
+      CacheStats cache_stats = cache->getStats();
+      stats.evictions_ += cache_stats.evictions_;
+      stats.silent_evictions_ += cache_stats.silent_evictions_;
+      stats.stale_invalidations_ += cache_stats.stale_invalidations_;
+      stats.stale_fetches_ += cache_stats.stale_fetches_;
+    }
+  // a stale fetch costs the fetch and the nack
+  size_t extra = stats.stale_invalidations_ + 2 * stats.stale_fetches_;
+
+  out << "\t** Silent Clean Evictions ***\n\n"
+      << "Evictions:\t\t\t" << stats.evictions_ << "\n"
+      << "Silent Evictions:\t\t" << stats.silent_evictions_ << "\n"
+      << "Stale Sharer Invalidations:\t" << stats.stale_invalidations_ << "\n"
+      << "Stale Owner Fetches:\t\t" << stats.stale_fetches_ << "\n"
+      << "Eviction Messages Avoided:\t" << stats.silent_evictions_ << "\n"
+      << "Stale Messages Added:\t\t" << extra << "\n"
+      << "Net Messages Saved:\t\t" << (long)stats.silent_evictions_ - (long)extra << "\n"
+      << std::endl;
+}
+
+void printPrefetchStats(std::ostream &out, const std::vector<NUMANode *> &nodes)
+{
+  CacheStats stats;
+  for (const NUMANode *node : nodes)
+    for (const Cache *cache : node->getCaches())
+    {
+      CacheStats cache_stats = cache->getStats();
+      stats.misses_ += cache_stats.misses_;
+      stats.prefetches_ += cache_stats.prefetches_;
+      stats.remote_prefetches_ += cache_stats.remote_prefetches_;
+      stats.useful_prefetches_ += cache_stats.useful_prefetches_;
+      stats.late_prefetches_ += cache_stats.late_prefetches_;
+      stats.unused_prefetches_ += cache_stats.unused_prefetches_;
+      stats.prefetch_global_events_ += cache_stats.prefetch_global_events_;
+    }
+  size_t global_events = 0;
+  for (const NUMANode *node : nodes)
+    global_events += node->getGlobalEvents();
+
+  std::ios::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(1);
+
+  // accuracy: used / issued, coverage: misses removed / misses without prefetching
+  size_t would_miss = stats.misses_ + stats.useful_prefetches_;
+  out << "\t** Prefetching ***\n\n"
+      << "Prefetches Issued:\t\t" << stats.prefetches_ << "\n"
+      << "Remote Prefetches:\t\t" << stats.remote_prefetches_ << "\n"
+      << "Useful Prefetches:\t\t" << stats.useful_prefetches_ << "\n"
+      << "Late Prefetches:\t\t" << stats.late_prefetches_ << "\n"
+      << "Unused Prefetches:\t\t" << stats.unused_prefetches_ << "\n"
+      << "Accuracy:\t\t\t"
+      << (stats.prefetches_ ? 100.0 * stats.useful_prefetches_ / stats.prefetches_ : 0.0) << "%\n"
+      << "Coverage:\t\t\t" << (would_miss ? 100.0 * stats.useful_prefetches_ / would_miss : 0.0) << "%\n"
+      << "Lateness:\t\t\t"
+      << (stats.useful_prefetches_ ? 100.0 * stats.late_prefetches_ / stats.useful_prefetches_ : 0.0) << "%\n"
+      << "Prefetch Global Events:\t\t" << stats.prefetch_global_events_ << " of " << global_events << "\n"
+      << "Prefetch Global Latency:\t"
+      << outputLatency(stats.prefetch_global_events_ * GLOBAL_INTERCONNECT_LATENCY) << "\n"
+      << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void printSharedCacheStats(std::ostream &out, const std::vector<NUMANode *> &nodes)
+{
+  SharedCacheStats llc, remote;
+  for (const NUMANode *node : nodes)
+  {
+    for (int i = 0; i < 2; ++i)
+    {
+      const SharedCache *cache = i == 0 ? node->getLLC() : node->getRemoteCache();
+      if (cache == nullptr)
+        continue;
+      const SharedCacheStats &stats = cache->getStats();
+      SharedCacheStats &total = i == 0 ? llc : remote;
+      total.hits_ += stats.hits_;
+      total.remote_hits_ += stats.remote_hits_;
+      total.misses_ += stats.misses_;
+      total.fills_ += stats.fills_;
+      total.evictions_ += stats.evictions_;
+      total.invalidations_ += stats.invalidations_;
+      total.back_invalidations_ += stats.back_invalidations_;
+    }
+  }
+
+  std::ios::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(1);
+
+  out << "\t** Shared Caches ***\n\n";
+  const char *names[] = {"LLC", "Remote Cache"};
+  for (int i = 0; i < 2; ++i)
+  {
+    const SharedCacheStats &stats = i == 0 ? llc : remote;
+    if (nodes[0]->getLLC() == nullptr && i == 0)
+      continue;
+    if (nodes[0]->getRemoteCache() == nullptr && i == 1)
+      continue;
+    size_t lookups = stats.hits_ + stats.misses_;
+    out << names[i] << "\n"
+        << "Read Hits:\t\t" << stats.hits_ << "\t(" << (lookups ? 100.0 * stats.hits_ / lookups : 0.0)
+        << "%)\n"
+        << "Remote Line Hits:\t" << stats.remote_hits_ << "\n"
+        << "Read Misses:\t\t" << stats.misses_ << "\n"
+        << "Fills:\t\t\t" << stats.fills_ << "\n"
+        << "Evictions:\t\t" << stats.evictions_ << "\n"
+        << "Invalidations:\t\t" << stats.invalidations_ << "\n";
+    if (i == 0)
+      out << "Back Invalidations:\t" << stats.back_invalidations_ << "\n";
+    out << "\n";
+  }
+
+  // each hit on a remote line saves the request to the home node and the reply
+  size_t avoided = llc.remote_hits_ + remote.remote_hits_;
+  out << "Remote Requests Avoided:\t" << avoided << "\n"
+      << "Global Events Avoided:\t\t" << 2 * avoided << "\n"
+      << "Global Latency Avoided:\t\t" << outputLatency(2 * avoided * GLOBAL_INTERCONNECT_LATENCY) << "\n"
+      << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void printAccessSizeStats(std::ostream &out, const AccessSizeStats &stats)
+{
+  std::ios::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(1);
+
+  out << "\t** Access Sizes ***\n\n"
+      << "Sized Accesses:\t\t" << stats.sized_accesses << "\n"
+      << "Average Size:\t\t" << (stats.sized_accesses ? (double)stats.bytes / stats.sized_accesses : 0.0)
+      << " bytes\n"
+      << "Split Accesses:\t\t" << stats.split_accesses << "\t("
+      << (stats.sized_accesses ? 100.0 * stats.split_accesses / stats.sized_accesses : 0.0) << "%)\n"
+      << "Line Requests:\t\t" << stats.line_requests << "\n";
+  // split onto a page the trace gives no home for
+  if (stats.unresolved_lines > 0)
+  {
+    out << "Unresolved Lines:\t" << stats.unresolved_lines << "\n";
+  }
+  out << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
+
+// latency is the modeled time of every access
+void printAtomicStats(std::ostream &out, const AtomicStats &stats, size_t latency)
+{
+  std::ios::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(1);
+
+  out << "\t** Atomics ***\n\n"
+      << "Atomics:\t\t\t" << stats.atomics << "\n"
+      << "Already Exclusive:\t\t" << stats.owned << "\t("
+      << (stats.atomics ? 100.0 * stats.owned / stats.atomics : 0.0) << "%)\n"
+      << "Atomic Latency:\t\t\t" << outputLatency(stats.latency) << "\t("
+      << (latency ? 100.0 * stats.latency / latency : 0.0) << "% of all)\n"
+      << "Average Atomic Latency:\t\t" << (stats.atomics ? (double)stats.latency / stats.atomics : 0.0)
+      << " ns\n"
+      << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void writeResults(ResultsWriter &writer, const std::vector<NUMANode *> &nodes, const RunInfo &info, size_t total_events,
+                  size_t total_events_skip0)
+{
+  NodeStats stats, stats_skip0;
+  for (NUMANode *node : nodes)
+  {
+    stats += node->getStats(false);
+    stats_skip0 += node->getStats(true);
+  }
+
+  writer.beginResults(info);
+  writer.writeAggregate("aggregate", stats, total_events);
+  writer.writeAggregate("aggregate_skip0", stats_skip0, total_events_skip0);
+  writer.beginNodes();
+  for (NUMANode *node : nodes)
+    writer.writeNode(*node);
+  writer.endNodes();
+  writer.endResults();
+}
+
+void saveCheckpoint(const SimOptions &opts, const Simulator &sim, RecordSource &reader, size_t total_events,
+                    size_t total_events_skip0)
+{
+  TracePosition position;
+  position.offset = reader.tell();
+  position.line_no = reader.getLineNumber();
+  position.accesses = total_events;
+  position.accesses_skip0 = total_events_skip0;
+  position.sizes = sim.getAccessSizeStats();
+  position.atomics = sim.getAtomicStats();
+  if (!writeCheckpoint(opts.checkpoint_path, opts.info, sim.getNodes(), sim.getPageMapper(), sim.getMigrator(),
+                       position))
+  {
+    std::cerr << "Cannot write checkpoint " << opts.checkpoint_path << "\n";
+    exit(1);
+  }
+}
+
+// replays the first accesses of a co-scheduled program by itself on the same
+// procs under the same policies, charging their latency to the program
+void runAlone(const SimOptions &opts, RecordSource &program, size_t accesses)
+{
+  Simulator sim(opts.machine);
+  if (opts.machine.affinity == AffinityPolicy::MAP)
+  {
+    sim.loadAffinityMap(opts.affinity_map);
+  }
+
+  TraceRecord record;
+  for (size_t i = 0; i < accesses && program.next(record); ++i)
+  {
+    size_t before = sim.getStats().latency();
+    sim.access(record);
+    program.charge(sim.getStats().latency() - before);
+  }
+}
+
+// cosched is the reader when several traces run together, nullptr otherwise
+void runSimulation(RecordSource &reader, const SimOptions &opts, CoScheduler *cosched)
+{
+  SelfProfile *profile = opts.self_profile ? new SelfProfile(opts.perf_counters) : nullptr;
+
+  int procs = opts.machine.procs;
+  int numa_nodes = opts.machine.numa_nodes;
+
+  Simulator sim(opts.machine);
+  if (opts.machine.affinity == AffinityPolicy::MAP)
+  {
+    std::string error = sim.loadAffinityMap(opts.affinity_map);
+    if (error != "")
+    {
+      std::cerr << "Invalid affinity map: " << error << "\n";
+      exit(1);
+    }
+  }
+  const std::vector<NUMANode *> &nodes = sim.getNodes();
+  PageMapper *page_mapper = sim.getPageMapper();
+  PageMigrator *migrator = sim.getMigrator();
+
+  if (opts.format == OutputFormat::TEXT)
+  {
+    std::cout << "Running simulation with cache settings:\n";
+    nodes[0]->getCaches()[0]->printConfig();
+  }
+
+  std::ofstream interval_file;
+  IntervalRecorder *intervals = nullptr;
+  if (opts.interval > 0)
+  {
+    interval_file.open(opts.interval_path);
+    if (!interval_file.is_open())
+    {
+      std::cerr << "Cannot open interval file " << opts.interval_path << "\n";
+      exit(1);
+    }
+    intervals = new IntervalRecorder(interval_file, opts.interval, opts.interval_unit);
+  }
+
+  LineProfiler *profiler = nullptr;
+  if (opts.hot_lines > 0)
+  {
+    profiler = new LineProfiler(std::max(opts.hot_lines_capacity, opts.hot_lines), opts.machine.b);
+    for (NUMANode *node : nodes)
+      node->attachProfiler(profiler);
+  }
+
+  SharingAnalyzer *analyzer = nullptr;
+  if (opts.false_sharing > 0)
   {
-    NUMANode *node = NewNumaNode(procs, numa_nodes, i, s, E, b, protocol);
-    nodes.push_back(node);
+    analyzer = new SharingAnalyzer(procs, opts.machine.s, opts.machine.E, opts.machine.b, opts.access_size);
+    sim.attachAnalyzer(analyzer);
   }
 
-  setupInterconnects(nodes);
-  int total_events = 0;
-  int total_events_skip0 = 0;
+  IpProfiler *ip_profiler = nullptr;
+  if (opts.ip_profile > 0)
+  {
+    ip_profiler = new IpProfiler(opts.ip_binary, opts.ip_base);
+  }
+
+  TrafficMatrix *traffic = nullptr;
+  if (opts.traffic_path != "")
+  {
+    traffic = new TrafficMatrix(numa_nodes, 1 << opts.machine.b);
+    for (NUMANode *node : nodes)
+      node->attachTraffic(traffic);
+  }
 
-  int proc;    // the requesting proc
-  char rw;     // whether it is a read or write
-  int node_id; // the node where addr resides
-  size_t addr;
+  // analysis reports go to stdout unless the structured results are using it
+  std::ostream &report = opts.format == OutputFormat::TEXT || opts.output_path != "" ? std::cout : std::cerr;
 
-  while (trace >> proc >> rw >> std::hex >> addr >> std::dec >> node_id)
+  size_t total_events = 0;
+  size_t total_events_skip0 = 0;
+
+  TraceRecord record;
+  NodeStats before;
+
+  if (opts.restore_path != "")
   {
-    if (node_id >= numa_nodes or proc >= procs)
+    TracePosition position;
+    std::string error = readCheckpoint(opts.restore_path, opts.info, nodes, page_mapper, migrator, position);
+    if (error == "" && !reader.seek(position.offset, position.line_no))
+      error = "the trace is shorter than the checkpointed one";
+    if (error != "")
+    {
+      std::cerr << "Cannot restore checkpoint: " << error << "\n";
+      exit(1);
+    }
+    total_events = position.accesses;
+    total_events_skip0 = position.accesses_skip0;
+    sim.setAccessSizeStats(position.sizes);
+    sim.setAtomicStats(position.atomics);
+    if (intervals)
+    {
+      intervals->resume(nodes, total_events);
+    }
+  }
+
+  if (profile)
+  {
+    profile->switchTo(Phase::PARSE);
+  }
+  while (reader.next(record))
+  {
+    if (profile)
+    {
+      profile->switchTo(Phase::SIMULATE);
+    }
+
+    if (ip_profiler || reader.timed())
+    {
+      before = sim.getStats();
+    }
+
+    if (!sim.access(record))
     {
       std::cout << "Invalid value of p or n for given trace\n";
       exit(1);
     }
 
-    // get the NUMA node that the requesting proc belongs to
-    int proc_node = procToNode(proc, procs, numa_nodes);
-    if (rw == 'R')
+    if (ip_profiler || reader.timed())
     {
-      nodes[proc_node]->cacheRead(proc, addr, node_id);
+      NodeStats after = sim.getStats();
+      if (ip_profiler)
+      {
+        const Placement &placed = sim.getLastPlacement();
+        ip_profiler->recordAccess(record.ip, before, after, placed.home != placed.proc_node, record.count);
+      }
+      reader.charge(after.latency() - before.latency());
+    }
+    // a run counts every access, it is never split so checkpoints and
+    // --stop-after fall on the first record boundary after their access
+    total_events += record.count;
+    if (record.proc != 0)
+    {
+      total_events_skip0 += record.count;
+    }
+    if (intervals)
+    {
+      intervals->record(nodes, total_events);
+    }
+    if (opts.checkpoint_every > 0 &&
+        total_events / opts.checkpoint_every != (total_events - record.count) / opts.checkpoint_every)
+    {
+      saveCheckpoint(opts, sim, reader, total_events, total_events_skip0);
+    }
+    if (profile)
+    {
+      profile->switchTo(Phase::PARSE);
+    }
+    if (opts.stop_after > 0 && total_events >= opts.stop_after)
+    {
+      break;
+    }
+  }
+
+  if (opts.checkpoint_path != "")
+  {
+    saveCheckpoint(opts, sim, reader, total_events, total_events_skip0);
+  }
+
+  if (profile)
+  {
+    profile->switchTo(Phase::REPORT);
+  }
+
+  if (intervals)
+  {
+    intervals->finish(nodes, total_events);
+    delete intervals;
+  }
+
+  if (opts.format != OutputFormat::TEXT)
+  {
+    std::ofstream file;
+    if (opts.output_path != "")
+    {
+      file.open(opts.output_path);
+      if (!file.is_open())
+      {
+        std::cerr << "Cannot open output file " << opts.output_path << "\n";
+        exit(1);
+      }
+    }
+    std::ostream &out = file.is_open() ? file : std::cout;
+
+    if (opts.format == OutputFormat::JSON)
+    {
+      JsonResultsWriter writer(out);
+      writeResults(writer, nodes, opts.info, total_events, total_events_skip0);
     }
     else
     {
-      nodes[proc_node]->cacheWrite(proc, addr, node_id);
+      CsvResultsWriter writer(out);
+      writeResults(writer, nodes, opts.info, total_events, total_events_skip0);
+    }
+  }
+  else
+  {
+    if (opts.aggregate)
+    {
+      printAggregateStats(nodes, total_events, false);
+    }
+
+    if (opts.aggr_skip0)
+    {
+      printAggregateStats(nodes, total_events_skip0, true);
     }
-    total_events++;
-    if (proc != 0)
+  }
+
+  if (opts.machine.snoop)
+  {
+    printSnoopStats(report, nodes);
+  }
+
+  if (opts.machine.silent_evictions)
+  {
+    printSilentEvictionStats(report, nodes);
+  }
+
+  if (opts.machine.prefetch != PrefetchPolicy::NONE)
+  {
+    printPrefetchStats(report, nodes);
+  }
+
+  if (opts.machine.llc || opts.machine.remote_cache)
+  {
+    printSharedCacheStats(report, nodes);
+  }
+
+  // only traces with sz= have sizes to report
+  if (sim.getAccessSizeStats().sized_accesses > 0)
+  {
+    printAccessSizeStats(report, sim.getAccessSizeStats());
+  }
+
+  // only traces with A records have atomics to report
+  if (sim.getAtomicStats().atomics > 0)
+  {
+    printAtomicStats(report, sim.getAtomicStats(), sim.getStats().latency());
+  }
+
+  if (cosched)
+  {
+    // slowdowns need every program's latency on an otherwise idle machine
+    for (int program = 0; program < cosched->getPrograms(); ++program)
     {
-      total_events_skip0++;
+      size_t accesses = cosched->getAccesses(program);
+      if (!cosched->isolate(program))
+      {
+        std::cerr << "Cannot rewind trace " << program << " for its run alone\n";
+        exit(1);
+      }
+      runAlone(opts, *cosched, accesses);
     }
+    cosched->printReport(report);
+  }
+
+  if (sim.getAffinity())
+  {
+    sim.getAffinity()->printReport(report);
   }
 
-  if (aggregate)
+  if (page_mapper)
   {
-    printAggregateStats(nodes, total_events, false);
+    page_mapper->printReport(report);
   }
 
-  if (aggr_skip0)
+  if (migrator)
   {
-    printAggregateStats(nodes, total_events_skip0, true);
+    migrator->printReport(report);
+  }
+
+  if (profiler)
+  {
+    profiler->printReport(report, opts.hot_lines, nodes);
+    delete profiler;
+  }
+
+  if (analyzer)
+  {
+    analyzer->printReport(report, opts.false_sharing);
+    delete analyzer;
+  }
+
+  if (ip_profiler)
+  {
+    ip_profiler->printReport(report, opts.ip_profile);
+    delete ip_profiler;
+  }
+
+  if (traffic)
+  {
+    std::ofstream traffic_file(opts.traffic_path);
+    if (!traffic_file.is_open())
+    {
+      std::cerr << "Cannot open traffic file " << opts.traffic_path << "\n";
+      exit(1);
+    }
+    traffic->writeCsv(traffic_file);
+    traffic->printSummary(report);
+    delete traffic;
   }
 
   for (NUMANode *node : nodes)
   {
-    if (individual)
+    if (opts.individual && opts.format == OutputFormat::TEXT)
     {
       node->printStats();
     }
-    delete node;
+  }
+
+  if (profile)
+  {
+    profile->stop();
+    profile->print(report, total_events);
+    delete profile;
   }
 }
 
 int main(int argc, char **argv)
 {
   std::string usage;
-  usage += "-t <tracefile>: name of the trace file\n";
+  usage += "-t <tracefile>: name of the trace file, given several times the traces run side by side\n";
+  usage += "--co-procs <n,n,...>: procs of each co-scheduled trace, in -t order, default is an even split. A "
+           "trace's node ids are mapped onto the nodes of its procs\n";
+  usage += "--interleave <round-robin | proportional | timestamp>: how co-scheduled traces take turns, one access each,\n"
+           "    one per proc each, or the trace furthest behind in simulated time, default is round-robin\n";
+  usage += "--merge <ts | ic | sim>: reorder each trace's threads by the recorded ts= time, by the ic= instruction\n"
+           "    count or by each thread's simulated time, instead of the order the tracer wrote them\n";
+  usage += "--merge-window <N>: records read ahead to find each thread's next one, default is 1048576\n";
+  usage += "-g <pattern>: generate accesses instead of reading a trace, one of uniform, zipf, producer-consumer,\n"
+           "    migratory, read-mostly, ts-lock or ticket-lock\n";
+  usage += "--gen-accesses <N>: accesses to generate, default is 1000000\n";
+  usage += "--gen-lines <N>: shared lines the patterns spread over, default is 4096\n";
+  usage += "--gen-writes <fraction>: writes of uniform and zipf (default 0.3) and read-mostly (default 0.02)\n";
+  usage += "--gen-zipf <theta>: zipf skew in [0, 1), default is 0.99\n";
+  usage += "--gen-seed <N>: generator seed, the same seed gives the same accesses, default is 1\n";
   usage += "-p <processors>: number of processors\n";
   usage += "-n <numa nodes>: number of NUMA nodes\n";
-  usage += "-m <MSI | MOESI>: the cache protocol to use, default is MOESI\n";
+  usage += "-m <MSI | MESI | MESIF | MOESI>: the cache protocol to use, default is MOESI\n";
+  usage += "--snoop: caches snoop a bus inside each node, only requests leaving a node use the home directory\n";
+  usage += "--silent-evictions: drop clean lines without notifying the directory, which then sends stale invalidations\n";
+  usage += "--prefetch <next-line | ip-stride | stream>: prefetch into every cache, ip-stride needs ip= in the trace\n";
+  usage += "--prefetch-degree <N>: lines prefetched per trigger, default is 1\n";
+  usage += "--affinity <compact | scatter>: run trace threads on procs filling nodes in order or round robin over nodes\n";
+  usage += "--affinity-map <file>: run trace thread i on the proc given by the i-th number in file\n";
+  usage += "--placement <trace | first-touch | interleave | preferred | hash>: choose home nodes instead of using the trace's\n";
+  usage += "--page-size <bytes>: placement and interleave granularity, default is 4096\n";
+  usage += "--preferred-node <n>: node used by --placement preferred, default is 0\n";
+  usage += "--migrate: move pages to the node that dominates their sampled accesses\n";
+  usage += "--migrate-threshold <N>: samples of a page before it is reconsidered, default is 8\n";
+  usage += "--migrate-sample <N>: sample one in N accesses at random, default is 16\n";
+  usage += "--replicate: give pages read by several nodes a read-only copy per node, implies --migrate\n";
+  usage += "--llc <inclusive | exclusive | nine>: add a last level cache shared by each node's processors\n";
+  usage += "--llc-sets <bits>: llc index bits, default is 10\n";
+  usage += "--llc-ways <n>: llc associativity, default is 16\n";
+  usage += "--remote-cache: add a per node cache of lines homed on other nodes\n";
+  usage += "--remote-cache-sets <bits>: remote cache index bits, default is 8\n";
+  usage += "--remote-cache-ways <n>: remote cache associativity, default is 8\n";
+  usage += "--checkpoint <file>: save the machine state and trace position to file when the run ends\n";
+  usage += "--checkpoint-every <N>: also save it every N accesses, replacing the previous one\n";
+  usage += "--stop-after <N>: end the run once N accesses have been simulated, counting restored ones\n";
+  usage += "--restore <file>: resume a checkpoint of the same trace, protocol, geometry and placement\n";
   usage += "-s <s>: cache index bits (sets = 2^s)\n";
   usage += "-E <E>: cache associativity\n";
   usage += "-b <b>: cache offset bits (line size = 2^b)\n";
   usage += "-a: display aggregate stats\n";
   usage += "-A: display aggregate stats without process 0\n";
   usage += "-i: display individual stats (i.e.per cache, per NUMA node)\n";
+  usage += "-f, --format <text | json | csv>: output format, json and csv always contain all stats\n";
+  usage += "-o, --output <file>: write json/csv results to file instead of stdout\n";
+  usage += "--interval <N>: write stat deltas every N accesses to the interval file\n";
+  usage += "--interval-ns <N>: write stat deltas every N simulated nanoseconds instead\n";
+  usage += "--interval-file <file>: where interval stats go, default is intervals.csv\n";
+  usage += "--hot-lines <K>: report the K lines with the most coherence traffic\n";
+  usage += "--hot-lines-capacity <C>: lines tracked by the hot line sketch, default is 4096\n";
+  usage += "--false-sharing <K>: classify misses and report the K lines with the most false sharing\n";
+  usage += "--access-size <bytes>: size of accesses without sz= for the sharing analysis, default is 4\n";
+  usage += "--ip-profile <K>: report the K instructions causing the most modeled latency (needs ip= in the trace)\n";
+  usage += "--ip-binary <file>: symbolize the instruction report with addr2line on this binary\n";
+  usage += "--ip-base <hex>: load address subtracted from ips before symbolizing, for PIE binaries\n";
+  usage += "--traffic <file>: write the node x node x message type traffic matrix as csv\n";
+  usage += "--self-profile: report the simulator's own throughput, phase times and peak RSS\n";
+  usage += "--perf-counters: also read hardware counters for the simulator with perf_event_open\n";
   usage += "-h: help\n";
 
-  char opt;
-  std::string filepath;
+  static const struct option long_options[] = {
+      {"format", required_argument, nullptr, 'f'},
+      {"output", required_argument, nullptr, 'o'},
+      {"help", no_argument, nullptr, 'h'},
+      {"interval", required_argument, nullptr, OPT_INTERVAL},
+      {"interval-ns", required_argument, nullptr, OPT_INTERVAL_NS},
+      {"interval-file", required_argument, nullptr, OPT_INTERVAL_FILE},
+      {"hot-lines", required_argument, nullptr, OPT_HOT_LINES},
+      {"hot-lines-capacity", required_argument, nullptr, OPT_HOT_LINES_CAPACITY},
+      {"false-sharing", required_argument, nullptr, OPT_FALSE_SHARING},
+      {"access-size", required_argument, nullptr, OPT_ACCESS_SIZE},
+      {"ip-profile", required_argument, nullptr, OPT_IP_PROFILE},
+      {"ip-binary", required_argument, nullptr, OPT_IP_BINARY},
+      {"ip-base", required_argument, nullptr, OPT_IP_BASE},
+      {"traffic", required_argument, nullptr, OPT_TRAFFIC},
+      {"self-profile", no_argument, nullptr, OPT_SELF_PROFILE},
+      {"perf-counters", no_argument, nullptr, OPT_PERF_COUNTERS},
+      {"snoop", no_argument, nullptr, OPT_SNOOP},
+      {"silent-evictions", no_argument, nullptr, OPT_SILENT_EVICTIONS},
+      {"prefetch", required_argument, nullptr, OPT_PREFETCH},
+      {"prefetch-degree", required_argument, nullptr, OPT_PREFETCH_DEGREE},
+      {"affinity", required_argument, nullptr, OPT_AFFINITY},
+      {"affinity-map", required_argument, nullptr, OPT_AFFINITY_MAP},
+      {"placement", required_argument, nullptr, OPT_PLACEMENT},
+      {"page-size", required_argument, nullptr, OPT_PAGE_SIZE},
+      {"preferred-node", required_argument, nullptr, OPT_PREFERRED_NODE},
+      {"migrate", no_argument, nullptr, OPT_MIGRATE},
+      {"migrate-threshold", required_argument, nullptr, OPT_MIGRATE_THRESHOLD},
+      {"migrate-sample", required_argument, nullptr, OPT_MIGRATE_SAMPLE},
+      {"replicate", no_argument, nullptr, OPT_REPLICATE},
+      {"llc", required_argument, nullptr, OPT_LLC},
+      {"llc-sets", required_argument, nullptr, OPT_LLC_SETS},
+      {"llc-ways", required_argument, nullptr, OPT_LLC_WAYS},
+      {"remote-cache", no_argument, nullptr, OPT_REMOTE_CACHE},
+      {"remote-cache-sets", required_argument, nullptr, OPT_REMOTE_CACHE_SETS},
+      {"remote-cache-ways", required_argument, nullptr, OPT_REMOTE_CACHE_WAYS},
+      {"checkpoint", required_argument, nullptr, OPT_CHECKPOINT},
+      {"checkpoint-every", required_argument, nullptr, OPT_CHECKPOINT_EVERY},
+      {"stop-after", required_argument, nullptr, OPT_STOP_AFTER},
+      {"restore", required_argument, nullptr, OPT_RESTORE},
+      {"gen-accesses", required_argument, nullptr, OPT_GEN_ACCESSES},
+      {"gen-lines", required_argument, nullptr, OPT_GEN_LINES},
+      {"gen-writes", required_argument, nullptr, OPT_GEN_WRITES},
+      {"gen-zipf", required_argument, nullptr, OPT_GEN_ZIPF},
+      {"gen-seed", required_argument, nullptr, OPT_GEN_SEED},
+      {"co-procs", required_argument, nullptr, OPT_CO_PROCS},
+      {"interleave", required_argument, nullptr, OPT_INTERLEAVE},
+      {"merge", required_argument, nullptr, OPT_MERGE},
+      {"merge-window", required_argument, nullptr, OPT_MERGE_WINDOW},
+      {nullptr, 0, nullptr, 0},
+  };
+
+  int opt;
+  std::vector<std::string> filepaths;
   std::string protocol;
+  std::string format;
+  std::string prefetch;
+  std::string placement;
+  std::string affinity;
+  std::string llc;
+  std::string pattern;
+  std::string co_procs;
+  std::string interleave;
+  std::string merge;
+  SimOptions opts;
 
-  // default to Intel L1 cache
-  int s = 6;
-  int E = 8;
-  int b = 6;
-  int procs = 1;
-  int numa_nodes = 1;
-  bool aggregate = false;
-  bool aggr_skip0 = false;
-  bool individual = false;
+  for (int i = 0; i < argc; ++i)
+    opts.info.command_line += (i ? " " : "") + std::string(argv[i]);
 
   // parse command line options
-  while ((opt = getopt(argc, argv, "hvaAis:E:b:t:p:n:m:")) != -1)
+  while ((opt = getopt_long(argc, argv, "hvaAis:E:b:t:g:p:n:m:f:o:", long_options, nullptr)) != -1)
   {
     switch (opt)
     {
@@ -194,74 +905,541 @@ int main(int argc, char **argv)
       std::cout << usage;
       return 0;
     case 'a':
-      aggregate = true;
+      opts.aggregate = true;
       break;
     case 'A':
-      aggr_skip0 = true;
+      opts.aggr_skip0 = true;
       break;
     case 'i':
-      individual = true;
+      opts.individual = true;
       break;
     case 's':
-      s = atoi(optarg);
+      opts.machine.s = atoi(optarg);
       break;
     case 'E':
-      E = atoi(optarg);
+      opts.machine.E = atoi(optarg);
       break;
     case 'b':
-      b = atoi(optarg);
+      opts.machine.b = atoi(optarg);
       break;
     case 't':
-      filepath = std::string(optarg);
+      filepaths.push_back(std::string(optarg));
+      break;
+    case 'g':
+      pattern = std::string(optarg);
       break;
     case 'p':
-      procs = atoi(optarg);
+      opts.machine.procs = atoi(optarg);
       break;
     case 'n':
-      numa_nodes = atoi(optarg);
+      opts.machine.numa_nodes = atoi(optarg);
       break;
     case 'm':
       protocol = std::string(optarg);
       break;
+    case 'f':
+      format = std::string(optarg);
+      break;
+    case 'o':
+      opts.output_path = std::string(optarg);
+      break;
+    case OPT_INTERVAL:
+      opts.interval = strtoull(optarg, nullptr, 10);
+      opts.interval_unit = IntervalUnit::ACCESSES;
+      break;
+    case OPT_INTERVAL_NS:
+      opts.interval = strtoull(optarg, nullptr, 10);
+      opts.interval_unit = IntervalUnit::NANOSECONDS;
+      break;
+    case OPT_INTERVAL_FILE:
+      opts.interval_path = std::string(optarg);
+      break;
+    case OPT_HOT_LINES:
+      opts.hot_lines = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_HOT_LINES_CAPACITY:
+      opts.hot_lines_capacity = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_FALSE_SHARING:
+      opts.false_sharing = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_ACCESS_SIZE:
+      opts.access_size = atoi(optarg);
+      break;
+    case OPT_IP_PROFILE:
+      opts.ip_profile = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_IP_BINARY:
+      opts.ip_binary = std::string(optarg);
+      break;
+    case OPT_IP_BASE:
+      opts.ip_base = strtoull(optarg, nullptr, 16);
+      break;
+    case OPT_TRAFFIC:
+      opts.traffic_path = std::string(optarg);
+      break;
+    case OPT_SELF_PROFILE:
+      opts.self_profile = true;
+      break;
+    case OPT_PERF_COUNTERS:
+      opts.self_profile = true;
+      opts.perf_counters = true;
+      break;
+    case OPT_SNOOP:
+      opts.machine.snoop = true;
+      break;
+    case OPT_SILENT_EVICTIONS:
+      opts.machine.silent_evictions = true;
+      break;
+    case OPT_PREFETCH:
+      prefetch = std::string(optarg);
+      break;
+    case OPT_PREFETCH_DEGREE:
+      opts.machine.prefetch_degree = atoi(optarg);
+      break;
+    case OPT_AFFINITY:
+      affinity = std::string(optarg);
+      break;
+    case OPT_AFFINITY_MAP:
+      opts.affinity_map = std::string(optarg);
+      break;
+    case OPT_PLACEMENT:
+      placement = std::string(optarg);
+      break;
+    case OPT_PAGE_SIZE:
+      opts.machine.page_size = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_PREFERRED_NODE:
+      opts.machine.preferred_node = atoi(optarg);
+      break;
+    case OPT_MIGRATE:
+      opts.machine.migrate = true;
+      break;
+    case OPT_MIGRATE_THRESHOLD:
+      opts.machine.migrate_threshold = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_MIGRATE_SAMPLE:
+      opts.machine.migrate_sample = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_REPLICATE:
+      opts.machine.migrate = true;
+      opts.machine.replicate = true;
+      break;
+    case OPT_LLC:
+      llc = std::string(optarg);
+      break;
+    case OPT_LLC_SETS:
+      opts.machine.llc_sets = atoi(optarg);
+      break;
+    case OPT_LLC_WAYS:
+      opts.machine.llc_ways = atoi(optarg);
+      break;
+    case OPT_REMOTE_CACHE:
+      opts.machine.remote_cache = true;
+      break;
+    case OPT_REMOTE_CACHE_SETS:
+      opts.machine.remote_cache_sets = atoi(optarg);
+      break;
+    case OPT_REMOTE_CACHE_WAYS:
+      opts.machine.remote_cache_ways = atoi(optarg);
+      break;
+    case OPT_CHECKPOINT:
+      opts.checkpoint_path = std::string(optarg);
+      break;
+    case OPT_CHECKPOINT_EVERY:
+      opts.checkpoint_every = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_STOP_AFTER:
+      opts.stop_after = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_RESTORE:
+      opts.restore_path = std::string(optarg);
+      break;
+    case OPT_GEN_ACCESSES:
+      opts.generator.accesses = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_GEN_LINES:
+      opts.generator.lines = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_GEN_WRITES:
+      opts.generator.write_ratio = atof(optarg);
+      break;
+    case OPT_GEN_ZIPF:
+      opts.generator.zipf_theta = atof(optarg);
+      break;
+    case OPT_GEN_SEED:
+      opts.generator.seed = strtoull(optarg, nullptr, 10);
+      break;
+    case OPT_CO_PROCS:
+      co_procs = std::string(optarg);
+      break;
+    case OPT_INTERLEAVE:
+      interleave = std::string(optarg);
+      break;
+    case OPT_MERGE:
+      merge = std::string(optarg);
+      break;
+    case OPT_MERGE_WINDOW:
+      opts.merge_window = strtoull(optarg, nullptr, 10);
+      break;
     default:
       std::cerr << usage;
       return 1;
     }
   }
 
-  // -t option is required
-  if (filepath == "")
+  // -t or -g is required
+  if (filepaths.empty() && pattern == "")
   {
     std::cerr << "No trace file given\n";
     return 1;
   }
+  if (!filepaths.empty() && pattern != "")
+  {
+    std::cerr << "-t and -g cannot be combined\n";
+    return 1;
+  }
+
+  if (pattern != "")
+  {
+    opts.generate = true;
+    if (pattern == "uniform")
+      opts.generator.pattern = Pattern::UNIFORM;
+    else if (pattern == "zipf")
+      opts.generator.pattern = Pattern::ZIPF;
+    else if (pattern == "producer-consumer")
+      opts.generator.pattern = Pattern::PRODUCER_CONSUMER;
+    else if (pattern == "migratory")
+      opts.generator.pattern = Pattern::MIGRATORY;
+    else if (pattern == "read-mostly")
+      opts.generator.pattern = Pattern::READ_MOSTLY;
+    else if (pattern == "ts-lock")
+      opts.generator.pattern = Pattern::TS_LOCK;
+    else if (pattern == "ticket-lock")
+      opts.generator.pattern = Pattern::TICKET_LOCK;
+    else
+    {
+      std::cerr << "Invalid generator pattern " << pattern << "\n";
+      return 1;
+    }
+  }
+  if (opts.generator.lines == 0 || opts.generator.write_ratio > 1 || opts.generator.zipf_theta < 0 ||
+      opts.generator.zipf_theta >= 1)
+  {
+    std::cerr << "Invalid generator parameters\n";
+    return 1;
+  }
 
-  Protocol prot;
   if (protocol == "" || protocol == "MOESI")
   {
     // default to MOESI
-    prot = Protocol::MOESI;
+    opts.machine.protocol = Protocol::MOESI;
+    opts.protocol_name = "MOESI";
   }
   else if (protocol == "MSI")
   {
-    prot = Protocol::MSI;
+    opts.machine.protocol = Protocol::MSI;
+    opts.protocol_name = "MSI";
+  }
+  else if (protocol == "MESI")
+  {
+    opts.machine.protocol = Protocol::MESI;
+    opts.protocol_name = "MESI";
+  }
+  else if (protocol == "MESIF")
+  {
+    opts.machine.protocol = Protocol::MESIF;
+    opts.protocol_name = "MESIF";
   }
   else
   {
     return 1;
   }
 
-  std::ifstream trace(filepath);
-  if (!trace.is_open())
+  if (prefetch == "next-line")
+  {
+    opts.machine.prefetch = PrefetchPolicy::NEXT_LINE;
+  }
+  else if (prefetch == "ip-stride")
+  {
+    opts.machine.prefetch = PrefetchPolicy::IP_STRIDE;
+  }
+  else if (prefetch == "stream")
   {
-    std::cerr << "Invalid trace file\n";
+    opts.machine.prefetch = PrefetchPolicy::STREAM;
+  }
+  else if (prefetch != "" && prefetch != "none")
+  {
+    std::cerr << "Invalid prefetcher " << prefetch << "\n";
+    return 1;
+  }
+  if (opts.machine.prefetch_degree < 1)
+  {
+    std::cerr << "Invalid prefetch degree\n";
     return 1;
   }
 
+  if (opts.affinity_map != "")
+  {
+    opts.machine.remap_threads = true;
+    opts.machine.affinity = AffinityPolicy::MAP;
+  }
+  else if (affinity != "")
+  {
+    opts.machine.remap_threads = true;
+    if (affinity == "compact")
+      opts.machine.affinity = AffinityPolicy::COMPACT;
+    else if (affinity == "scatter")
+      opts.machine.affinity = AffinityPolicy::SCATTER;
+    else
+    {
+      std::cerr << "Invalid affinity " << affinity << "\n";
+      return 1;
+    }
+  }
+  if (opts.machine.procs < 1 || opts.machine.numa_nodes < 1)
+  {
+    std::cerr << "Invalid number of processors or nodes\n";
+    return 1;
+  }
+  if (opts.access_size < 1)
+  {
+    std::cerr << "Invalid access size " << opts.access_size << "\n";
+    return 1;
+  }
+
+  if (placement != "")
+  {
+    opts.machine.remap_pages = true;
+    if (placement == "trace")
+      opts.machine.placement = PlacementPolicy::TRACE;
+    else if (placement == "first-touch")
+      opts.machine.placement = PlacementPolicy::FIRST_TOUCH;
+    else if (placement == "interleave")
+      opts.machine.placement = PlacementPolicy::INTERLEAVE;
+    else if (placement == "preferred")
+      opts.machine.placement = PlacementPolicy::PREFERRED;
+    else if (placement == "hash")
+      opts.machine.placement = PlacementPolicy::HASH;
+    else
+    {
+      std::cerr << "Invalid placement policy " << placement << "\n";
+      return 1;
+    }
+  }
+  // a page holds whole cache lines
+  size_t page_size = opts.machine.page_size;
+  if (page_size < ((size_t)1 << opts.machine.b) || (page_size & (page_size - 1)) != 0)
+  {
+    std::cerr << "Invalid page size " << opts.machine.page_size << "\n";
+    return 1;
+  }
+  if (opts.machine.preferred_node < 0 || opts.machine.preferred_node >= opts.machine.numa_nodes)
+  {
+    std::cerr << "Invalid preferred node " << opts.machine.preferred_node << "\n";
+    return 1;
+  }
+
+  if (llc != "")
+  {
+    opts.machine.llc = true;
+    if (llc == "inclusive")
+      opts.machine.llc_policy = InclusionPolicy::INCLUSIVE;
+    else if (llc == "exclusive")
+      opts.machine.llc_policy = InclusionPolicy::EXCLUSIVE;
+    else if (llc == "nine")
+      opts.machine.llc_policy = InclusionPolicy::NINE;
+    else
+    {
+      std::cerr << "Invalid llc inclusion policy " << llc << "\n";
+      return 1;
+    }
+  }
+  if (opts.machine.llc_sets < 0 || opts.machine.llc_ways < 1 || opts.machine.remote_cache_sets < 0 ||
+      opts.machine.remote_cache_ways < 1)
+  {
+    std::cerr << "Invalid shared cache geometry\n";
+    return 1;
+  }
+
+  if (opts.machine.migrate_sample == 0 || opts.machine.migrate_threshold == 0)
+  {
+    std::cerr << "Invalid migration sampling\n";
+    return 1;
+  }
+
+  if (opts.checkpoint_every > 0 && opts.checkpoint_path == "")
+  {
+    std::cerr << "--checkpoint-every needs a --checkpoint file\n";
+    return 1;
+  }
+
+  if (interleave == "" || interleave == "round-robin")
+    opts.interleave = Interleave::ROUND_ROBIN;
+  else if (interleave == "proportional")
+    opts.interleave = Interleave::PROPORTIONAL;
+  else if (interleave == "timestamp")
+    opts.interleave = Interleave::TIMESTAMP;
+  else
+  {
+    std::cerr << "Invalid interleave policy " << interleave << "\n";
+    return 1;
+  }
+  if (merge != "")
+  {
+    opts.merge = true;
+    if (merge == "ts")
+      opts.merge_order = MergeOrder::TIMESTAMP;
+    else if (merge == "ic")
+      opts.merge_order = MergeOrder::INSTRUCTIONS;
+    else if (merge == "sim")
+      opts.merge_order = MergeOrder::SIMULATED;
+    else
+    {
+      std::cerr << "Invalid merge order " << merge << "\n";
+      return 1;
+    }
+  }
+  if (opts.merge_window == 0)
+  {
+    std::cerr << "Invalid merge window\n";
+    return 1;
+  }
+  if (opts.merge_order == MergeOrder::SIMULATED && opts.restore_path != "")
+  {
+    std::cerr << "A run merged by simulated time cannot be restored\n";
+    return 1;
+  }
+
+  if (filepaths.size() > 1)
+  {
+    int programs = (int)filepaths.size();
+    std::istringstream fields(co_procs);
+    std::string field;
+    while (std::getline(fields, field, ','))
+      opts.co_procs.push_back(atoi(field.c_str()));
+    if (co_procs == "")
+    {
+      // split the procs like nodes split them
+      for (int program = 0; program < programs; ++program)
+        opts.co_procs.push_back(firstProcOfNode(program + 1, opts.machine.procs, programs) -
+                                firstProcOfNode(program, opts.machine.procs, programs));
+    }
+    int total = 0;
+    for (int program_procs : opts.co_procs)
+      total += program_procs < 1 ? opts.machine.procs + 1 : program_procs;
+    if ((int)opts.co_procs.size() != programs || total > opts.machine.procs)
+    {
+      std::cerr << "Invalid co-scheduled procs " << co_procs << "\n";
+      return 1;
+    }
+    if (opts.checkpoint_path != "" || opts.restore_path != "")
+    {
+      std::cerr << "Co-scheduled traces cannot be checkpointed\n";
+      return 1;
+    }
+  }
+
+  if (format == "" || format == "text")
+  {
+    opts.format = OutputFormat::TEXT;
+  }
+  else if (format == "json")
+  {
+    opts.format = OutputFormat::JSON;
+  }
+  else if (format == "csv")
+  {
+    opts.format = OutputFormat::CSV;
+  }
+  else
+  {
+    std::cerr << "Invalid output format " << format << "\n";
+    return 1;
+  }
+
+  std::vector<std::ifstream *> traces;
+  for (const std::string &filepath : filepaths)
+  {
+    traces.push_back(new std::ifstream(filepath));
+    if (!traces.back()->is_open())
+    {
+      std::cerr << "Invalid trace file\n";
+      return 1;
+    }
+  }
+
+  char started_at[32];
+  std::time_t now = std::time(nullptr);
+  std::strftime(started_at, sizeof(started_at), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+  for (const std::string &filepath : filepaths)
+    opts.info.trace += (opts.info.trace == "" ? "" : ",") + filepath;
+  if (opts.generate)
+    opts.info.trace = std::string("generated:") + patternName(opts.generator.pattern);
+  opts.info.started_at = started_at;
+  opts.info.protocol = opts.protocol_name;
+  opts.info.local_coherence = opts.machine.snoop ? "snoop" : "directory";
+  opts.info.placement = placementName(opts.machine.placement);
+  opts.info.affinity = affinityName(opts.machine.affinity);
+  opts.info.order = opts.merge ? mergeOrderName(opts.merge_order) : "trace";
+  opts.info.procs = opts.machine.procs;
+  opts.info.numa_nodes = opts.machine.numa_nodes;
+  opts.info.index_len = opts.machine.s;
+  opts.info.ways = opts.machine.E;
+  opts.info.offset_len = opts.machine.b;
+
+  // one source per program, merged by thread if asked to
+  std::vector<RecordSource *> readers, sources;
+  if (opts.generate)
+  {
+    opts.generator.procs = opts.machine.procs;
+    opts.generator.numa_nodes = opts.machine.numa_nodes;
+    opts.generator.offset_len = opts.machine.b;
+    opts.generator.page_size = opts.machine.page_size;
+    readers.push_back(new WorkloadGenerator(opts.generator));
+  }
+  for (std::ifstream *trace : traces)
+    readers.push_back(new TraceReader(*trace));
+  for (size_t program = 0; program < readers.size(); ++program)
+  {
+    RecordSource *reader = readers[program];
+    int threads = opts.co_procs.empty() ? opts.machine.procs : opts.co_procs[program];
+    sources.push_back(opts.merge ? new TraceMerger(*reader, opts.merge_order, opts.merge_window, threads) : reader);
+  }
+
   // run the input trace on the cache
-  runSimulation(s, E, b, trace, procs, numa_nodes, prot, individual, aggregate, aggr_skip0);
+  if (sources.size() == 1)
+  {
+    runSimulation(*sources[0], opts, nullptr);
+  }
+  else
+  {
+    CoScheduler cosched(opts.interleave);
+    int first_proc = 0;
+    for (size_t program = 0; program < sources.size(); ++program)
+    {
+      int procs = opts.co_procs[program];
+      int first_node = procToNode(first_proc, opts.machine.procs, opts.machine.numa_nodes);
+      int last_node = procToNode(first_proc + procs - 1, opts.machine.procs, opts.machine.numa_nodes);
+      cosched.addProgram(filepaths[program], sources[program], first_proc, procs, first_node,
+                         last_node - first_node + 1);
+      first_proc += opts.co_procs[program];
+    }
+    runSimulation(cosched, opts, &cosched);
+  }
 
-  trace.close();
+  for (size_t i = 0; i < readers.size(); ++i)
+  {
+    if (sources[i] != readers[i])
+      delete sources[i];
+    delete readers[i];
+  }
+  for (std::ifstream *trace : traces)
+  {
+    trace->close();
+    delete trace;
+  }
 
   return 0;
 }
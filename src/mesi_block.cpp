@@ -0,0 +1,86 @@
+#include "mesi_block.h"
+MESIBlock::MESIBlock(CacheStats *stats) : CacheBlock(stats), state_(MESI::I) {}
+bool MESIBlock::isValid() { return state_ != MESI::I; }
+
+CacheMsg MESIBlock::updateState(bool is_write)
+{
+    switch (state_)
+    {
+    case MESI::M:
+        stats_->hits_ += 1;
+        return CacheMsg::NOP;
+    case MESI::E:
+        stats_->hits_ += 1;
+        if (is_write)
+            state_ = MESI::M;
+        return CacheMsg::NOP;
+    case MESI::S:
+        if (is_write)
+        {
+            stats_->misses_ += 1;
+            state_ = MESI::M;
+            return CacheMsg::BUSRDX;
+        }
+        else
+        {
+            stats_->hits_ += 1;
+            return CacheMsg::NOP;
+        }
+    case MESI::I:
+        stats_->misses_ += 1;
+        state_ = is_write ? MESI::M : MESI::E;
+        return is_write ? CacheMsg::BUSRDX : CacheMsg::BUSRD;
+    }
+    return CacheMsg::NOP;
+}
+
+CacheMsg MESIBlock::writeBlock()
+{
+    lru_cnt_ = 0;
+    dirty_ = true;
+    return updateState(true);
+}
+CacheMsg MESIBlock::readBlock()
+{
+    lru_cnt_ = 0;
+    return updateState(false);
+}
+
+CacheMsg MESIBlock::evictAndReplace(bool is_write, size_t tag, int new_node)
+{
+    if (state_ != MESI::I)
+    {
+        if (dirty_)
+        {
+            stats_->flushes_ += 1;
+            stats_->dirty_evictions_ += 1;
+        }
+        stats_->evictions_ += 1;
+    }
+    dirty_ = is_write;
+    tag_ = tag;
+    lru_cnt_ = 0;
+    node_id_ = new_node;
+    state_ = MESI::I;
+    return updateState(is_write);
+}
+
+void MESIBlock::invalidate()
+{
+    stats_->invalidations_ += 1;
+    state_ = MESI::I;
+}
+
+// without an owned state a modified line is written back before it is shared
+void MESIBlock::fetch()
+{
+    assert(state_ == MESI::E || state_ == MESI::M);
+    if (state_ == MESI::M)
+    {
+        stats_->flushes_ += 1;
+        dirty_ = false;
+    }
+    state_ = MESI::S;
+}
+void MESIBlock::receiveReadData(bool exclusive) { state_ = exclusive ? MESI::E : MESI::S; }
+void MESIBlock::receiveWriteData() { state_ = MESI::M; }
@@ -0,0 +1,34 @@
+#pragma once
+#include "cache_block.h"
+
+enum class MESI
+{
+    M,
+    E,
+    S,
+    I
+};
+
+class MESIBlock : public CacheBlock
+{
+private:
+    CacheMsg updateState(bool is_write) override;
+    MESI state_;
+
+public:
+    MESIBlock(CacheStats *stats);
+    virtual ~MESIBlock() {}
+    virtual bool isValid() override;
+    virtual int getState() const override { return (int)state_; }
+    virtual void setState(int state) override { state_ = (MESI)state; }
+    virtual bool isModified() const override { return state_ == MESI::M; }
+    virtual CacheMsg writeBlock() override;
+    virtual CacheMsg readBlock() override;
+
+    virtual CacheMsg evictAndReplace(bool is_write, size_t tag, int new_node) override;
+
+    virtual void invalidate() override;
+    virtual void fetch() override;
+    virtual void receiveReadData(bool exclusive) override;
+    virtual void receiveWriteData() override;
+};
@@ -0,0 +1,88 @@
+#include "mesif_block.h"
+MESIFBlock::MESIFBlock(CacheStats *stats) : CacheBlock(stats), state_(MESIF::I) {}
+bool MESIFBlock::isValid() { return state_ != MESIF::I; }
+
+CacheMsg MESIFBlock::updateState(bool is_write)
+{
+    switch (state_)
+    {
+    case MESIF::M:
+        stats_->hits_ += 1;
+        return CacheMsg::NOP;
+    case MESIF::E:
+        stats_->hits_ += 1;
+        if (is_write)
+            state_ = MESIF::M;
+        return CacheMsg::NOP;
+    case MESIF::S:
+    case MESIF::F:
+        if (is_write)
+        {
+            stats_->misses_ += 1;
+            state_ = MESIF::M;
+            return CacheMsg::BUSRDX;
+        }
+        else
+        {
+            stats_->hits_ += 1;
+            return CacheMsg::NOP;
+        }
+    case MESIF::I:
+        stats_->misses_ += 1;
+        state_ = is_write ? MESIF::M : MESIF::E;
+        return is_write ? CacheMsg::BUSRDX : CacheMsg::BUSRD;
+    }
+    return CacheMsg::NOP;
+}
+
+CacheMsg MESIFBlock::writeBlock()
+{
+    lru_cnt_ = 0;
+    dirty_ = true;
+    return updateState(true);
+}
+CacheMsg MESIFBlock::readBlock()
+{
+    lru_cnt_ = 0;
+    return updateState(false);
+}
+
+CacheMsg MESIFBlock::evictAndReplace(bool is_write, size_t tag, int new_node)
+{
+    if (state_ != MESIF::I)
+    {
+        if (dirty_)
+        {
+            stats_->flushes_ += 1;
+            stats_->dirty_evictions_ += 1;
+        }
+        stats_->evictions_ += 1;
+    }
+    dirty_ = is_write;
+    tag_ = tag;
+    lru_cnt_ = 0;
+    node_id_ = new_node;
+    state_ = MESIF::I;
+    return updateState(is_write);
+}
+
+void MESIFBlock::invalidate()
+{
+    stats_->invalidations_ += 1;
+    state_ = MESIF::I;
+}
+
+// the line is supplied to the requester, who becomes the new forwarder
+void MESIFBlock::fetch()
+{
+    assert(state_ == MESIF::E || state_ == MESIF::M || state_ == MESIF::F);
+    if (state_ == MESIF::M)
+    {
+        stats_->flushes_ += 1;
+        dirty_ = false;
+    }
+    state_ = MESIF::S;
+}
+// shared data always makes the requester the forwarder
+void MESIFBlock::receiveReadData(bool exclusive) { state_ = exclusive ? MESIF::E : MESIF::F; }
+void MESIFBlock::receiveWriteData() { state_ = MESIF::M; }
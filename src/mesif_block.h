@@ -0,0 +1,35 @@
+#pragma once
+#include "cache_block.h"
+
+enum class MESIF
+{
+    M,
+    E,
+    S,
+    I,
+    F // shared, and the one sharer that forwards the line to new readers
+};
+
+class MESIFBlock : public CacheBlock
+{
+private:
+    CacheMsg updateState(bool is_write) override;
+    MESIF state_;
+
+public:
+    MESIFBlock(CacheStats *stats);
+    virtual ~MESIFBlock() {}
+    virtual bool isValid() override;
+    virtual int getState() const override { return (int)state_; }
+    virtual void setState(int state) override { state_ = (MESIF)state; }
+    virtual bool isModified() const override { return state_ == MESIF::M; }
+    virtual CacheMsg writeBlock() override;
+    virtual CacheMsg readBlock() override;
+
+    virtual CacheMsg evictAndReplace(bool is_write, size_t tag, int new_node) override;
+
+    virtual void invalidate() override;
+    virtual void fetch() override;
+    virtual void receiveReadData(bool exclusive) override;
+    virtual void receiveWriteData() override;
+};
@@ -17,11 +17,14 @@ private:
     MOESI state_;
 
 public:
-    MOESIBlock();
+    MOESIBlock(CacheStats *stats);
     virtual ~MOESIBlock() {}
     virtual bool isValid() override;
-    virtual CacheMsg writeBlock(int node_id) override;
-    virtual CacheMsg readBlock(int node_id) override;
+    virtual int getState() const override { return (int)state_; }
+    virtual void setState(int state) override { state_ = (MOESI)state; }
+    virtual bool isModified() const override { return state_ == MOESI::M; }
+    virtual CacheMsg writeBlock() override;
+    virtual CacheMsg readBlock() override;
 
     virtual CacheMsg evictAndReplace(bool is_write, size_t tag, int new_node) override;
 
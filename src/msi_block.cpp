@@ -1,6 +1,6 @@
 #include "msi_block.h"
 
-MSIBlock::MSIBlock() : CacheBlock(),
+MSIBlock::MSIBlock(CacheStats *stats) : CacheBlock(stats),
                        state_(MSI::I){};
 
 CacheMsg MSIBlock::updateState(bool is_write)
@@ -8,22 +8,22 @@ CacheMsg MSIBlock::updateState(bool is_write)
     switch (state_)
     {
     case MSI::M:
-        hit_ += 1;
+        stats_->hits_ += 1;
         return CacheMsg::NOP;
     case MSI::S:
         if (is_write)
         {
-            miss_++;
+            stats_->misses_++;
             state_ = MSI::M;
             return CacheMsg::BUSRDX;
         }
         else
         {
-            hit_++;
+            stats_->hits_++;
             return CacheMsg::NOP;
         }
     case MSI::I:
-        miss_ += 1;
+        stats_->misses_ += 1;
         state_ = is_write ? MSI::M : MSI::S;
         return is_write ? CacheMsg::BUSRDX : CacheMsg::BUSRD;
     }
@@ -31,17 +31,15 @@ CacheMsg MSIBlock::updateState(bool is_write)
 };
 
 bool MSIBlock::isValid() { return state_ != MSI::I; };
-CacheMsg MSIBlock::writeBlock(int node_id)
+CacheMsg MSIBlock::writeBlock()
 {
     lru_cnt_ = 0;
     dirty_ = true;
-    node_id_ = node_id;
     return updateState(true);
 };
-CacheMsg MSIBlock::readBlock(int node_id)
+CacheMsg MSIBlock::readBlock()
 {
     lru_cnt_ = 0;
-    node_id_ = node_id;
     return updateState(false);
 };
 
@@ -51,10 +49,10 @@ CacheMsg MSIBlock::evictAndReplace(bool is_write, size_t tag, int new_node)
     {
         if (dirty_)
         {
-            flushes_++;
-            dirty_evictions_++;
+            stats_->flushes_++;
+            stats_->dirty_evictions_++;
         }
-        evictions_++;
+        stats_->evictions_++;
     }
 
     tag_ = tag;
@@ -69,13 +67,13 @@ CacheMsg MSIBlock::evictAndReplace(bool is_write, size_t tag, int new_node)
 void MSIBlock::invalidate()
 {
     state_ = MSI::I;
-    invalidations_ += 1;
+    stats_->invalidations_ += 1;
 };
 void MSIBlock::fetch()
 {
     assert(state_ == MSI::M);
     state_ = MSI::S;
-    flushes_ += 1;
+    stats_->flushes_ += 1;
 };
 
 void MSIBlock::receiveReadData([[maybe_unused]] bool exclusive)
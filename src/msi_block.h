@@ -15,11 +15,14 @@ private:
     MSI state_;
 
 public:
-    MSIBlock();
+    MSIBlock(CacheStats *stats);
     virtual ~MSIBlock() {}
     virtual bool isValid() override;
-    virtual CacheMsg writeBlock(int numa_node) override;
-    virtual CacheMsg readBlock(int numa_node) override;
+    virtual int getState() const override { return (int)state_; }
+    virtual void setState(int state) override { state_ = (MSI)state; }
+    virtual bool isModified() const override { return state_ == MSI::M; }
+    virtual CacheMsg writeBlock() override;
+    virtual CacheMsg readBlock() override;
 
     virtual CacheMsg evictAndReplace(bool is_write, size_t tag, int new_node) override;
 
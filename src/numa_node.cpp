@@ -1,31 +1,41 @@
+#include <sstream>
+
 #include "numa_node.h"
+#include "checkpoint.h"
 #include "directory.h"
+#include "machine.h"
 #include "latencies.h"
+#include "line_profiler.h"
+#include "traffic_matrix.h"
 
 NUMANode::NUMANode(int node_id, int num_numa_nodes, int num_procs, Directory *directory, std::vector<Cache *> caches)
     : node_id_(node_id),
       num_numa_nodes_(num_numa_nodes),
       num_procs_(num_procs),
-      procs_per_node_(num_procs_ / num_numa_nodes_),
+      first_proc_(caches.empty() ? 0 : caches[0]->getID()),
       directory_(directory),
       caches_(caches),
+      profiler_(nullptr),
+      traffic_(nullptr),
+      snooping_(false),
+      snooped_(false),
+      llc_(nullptr),
+      llc_policy_(InclusionPolicy::INCLUSIVE),
+      remote_cache_(nullptr),
       cache_events_(0L),
       directory_events_(0L),
-      global_events_(0L)
+      global_events_(0L),
+      snoop_events_(0L)
 {
     interconnects_.resize(num_numa_nodes_);
     directory_->assignToNode(this);
     for (Cache *cache : caches_)
         cache->assignToNode(this);
-
-    if (node_id == 0)
-    {
-        std::cout << "Running simulation with cache settings:\n";
-        caches_[0]->printConfig();
-    }
 }
 NUMANode::~NUMANode()
 {
+    delete llc_;
+    delete remote_cache_;
     delete directory_;
     for (Cache *cache : caches_)
     {
@@ -33,14 +43,193 @@ NUMANode::~NUMANode()
     }
 }
 
-int NUMANode::getID() { return node_id_; }
+int NUMANode::getID() const { return node_id_; }
 
 void NUMANode::connectWith(NUMANode *node, int id)
 {
     interconnects_[id] = node;
 }
 
-int NUMANode::getNode(int dest) { return dest / (num_procs_ / num_numa_nodes_); }
+void NUMANode::attachProfiler(LineProfiler *profiler)
+{
+    profiler_ = profiler;
+    directory_->attachProfiler(profiler);
+}
+
+void NUMANode::attachAnalyzer(SharingAnalyzer *analyzer)
+{
+    for (Cache *cache : caches_)
+        cache->attachAnalyzer(analyzer);
+}
+
+void NUMANode::enableSilentEvictions()
+{
+    for (Cache *cache : caches_)
+        cache->enableSilentEvictions();
+}
+
+void NUMANode::attachPrefetchers(PrefetchPolicy policy, int offset_len, int degree, int page_bits)
+{
+    for (Cache *cache : caches_)
+        cache->attachPrefetcher(NewPrefetcher(policy, offset_len, degree), page_bits);
+}
+
+size_t NUMANode::getMachineGlobalEvents() const
+{
+    size_t events = 0;
+    for (const NUMANode *node : interconnects_)
+        events += node->global_events_;
+    return events;
+}
+
+void NUMANode::attachSharedCaches(SharedCache *llc, InclusionPolicy policy, SharedCache *remote_cache)
+{
+    llc_ = llc;
+    llc_policy_ = policy;
+    remote_cache_ = remote_cache;
+}
+
+bool NUMANode::readShared(int src, Addr addr)
+{
+    bool remote = addr.node_id != node_id_;
+    SharedCache *cache = nullptr;
+    if (llc_ && llc_->contains(addr.addr))
+        cache = llc_;
+    else if (remote_cache_ && remote && remote_cache_->contains(addr.addr))
+        cache = remote_cache_;
+    if (cache == nullptr)
+    {
+        if (llc_)
+            llc_->countMiss();
+        if (remote_cache_ && remote)
+            remote_cache_->countMiss();
+        return false;
+    }
+
+    // the home directory still learns about the new sharer, but no message
+    // leaves the node for it
+    NUMANode *home = remote ? interconnects_[addr.node_id] : this;
+    if (!home->directory_->addSharer(src, addr.addr))
+        return false;
+    cache->touch(addr.addr, remote);
+    if (cache == llc_ && llc_policy_ == InclusionPolicy::EXCLUSIVE)
+        llc_->remove(addr.addr);
+    cache_events_ += 1;
+    if (snooping_)
+        snoop_events_ += 1;
+    return true;
+}
+
+void NUMANode::fillShared(Addr addr)
+{
+    if (llc_ && llc_policy_ == InclusionPolicy::EXCLUSIVE)
+        llc_->remove(addr.addr);
+    else if (llc_)
+        insertLLC(addr.addr);
+    size_t victim;
+    if (remote_cache_ && addr.node_id != node_id_)
+        remote_cache_->insert(addr.addr, victim);
+}
+
+void NUMANode::evictPrivate(Addr addr, bool dirty)
+{
+    size_t victim;
+    if (llc_ && llc_policy_ == InclusionPolicy::EXCLUSIVE)
+        llc_->insert(addr.addr, victim);
+    // a write back passes through the other caches, their copies are current again
+    else if (llc_ && dirty)
+        insertLLC(addr.addr);
+    if (remote_cache_ && dirty && addr.node_id != node_id_)
+        remote_cache_->insert(addr.addr, victim);
+}
+
+void NUMANode::insertLLC(size_t addr)
+{
+    size_t victim;
+    if (!llc_->insert(addr, victim) || llc_policy_ != InclusionPolicy::INCLUSIVE)
+        return;
+    for (Cache *cache : caches_)
+        if (cache->backInvalidate(victim))
+            llc_->countBackInvalidation();
+}
+
+bool NUMANode::dropShared(size_t addr)
+{
+    bool dropped = false;
+    if (llc_)
+        dropped |= llc_->invalidate(addr);
+    if (remote_cache_)
+        dropped |= remote_cache_->invalidate(addr);
+    return dropped;
+}
+
+// the directory tracks shared caches as sharers, invalidating them is a
+// global message to each node that had the line
+void NUMANode::dropSharedElsewhere(size_t addr, int writer_node)
+{
+    for (NUMANode *node : interconnects_)
+    {
+        if (node->node_id_ == writer_node || !node->dropShared(addr))
+            continue;
+        directory_events_ += 1;
+        if (node != this)
+            global_events_ += 1;
+    }
+}
+
+void NUMANode::save(CheckpointWriter &out) const
+{
+    out.put(cache_events_);
+    out.put(directory_events_);
+    out.put(global_events_);
+    out.put(snoop_events_);
+    directory_->save(out);
+    for (const Cache *cache : caches_)
+        cache->save(out);
+
+    // sections, a restored run may drop the shared caches or change them
+    std::ostringstream llc, remote;
+    if (llc_)
+    {
+        CheckpointWriter section(llc);
+        section.put((uint64_t)llc_policy_);
+        llc_->save(section);
+    }
+    if (remote_cache_)
+    {
+        CheckpointWriter section(remote);
+        remote_cache_->save(section);
+    }
+    out.putString(llc.str());
+    out.putString(remote.str());
+}
+
+void NUMANode::load(CheckpointReader &in)
+{
+    cache_events_ = in.get();
+    directory_events_ = in.get();
+    global_events_ = in.get();
+    snoop_events_ = in.get();
+    directory_->load(in);
+    for (Cache *cache : caches_)
+        cache->load(in);
+
+    // they only ever hold clean copies, so a mismatched one can start cold
+    std::istringstream llc(in.getString()), remote(in.getString());
+    if (llc_ && llc.rdbuf()->in_avail() > 0)
+    {
+        CheckpointReader section(llc);
+        if (section.get() == (uint64_t)llc_policy_)
+            llc_->load(section);
+    }
+    if (remote_cache_ && remote.rdbuf()->in_avail() > 0)
+    {
+        CheckpointReader section(remote);
+        remote_cache_->load(section);
+    }
+}
+
+int NUMANode::getNode(int dest) { return procToNode(dest, num_procs_, num_numa_nodes_); }
 
 NodeStats NUMANode::getStats(bool skip0) const
 {
@@ -70,6 +259,9 @@ void NUMANode::printStats() const
               << "\n"
               << "Global Events Latency:\t"
               << outputLatency(global_events_ * GLOBAL_INTERCONNECT_LATENCY) << "\n";
+    if (snooping_)
+        std::cout << "Snoop Events:\t\t\t" << snoop_events_ << "\n"
+                  << "Snoop Events Latency:\t" << outputLatency(snoop_events_ * LOCAL_INTERCONNECT_LATENCY) << "\n";
     std::cout << std::endl;
 
     std::cout << "*** Memory Reads ***\n";
@@ -79,39 +271,115 @@ void NUMANode::printStats() const
     std::cout << std::endl;
 }
 
-void NUMANode::cacheRead(int proc, unsigned long addr, int numa_node)
+void NUMANode::cacheRead(int proc, unsigned long addr, int numa_node, size_t ip)
+{
+    caches_[proc - first_proc_]->cacheRead({addr, numa_node}, ip);
+}
+
+void NUMANode::cacheWrite(int proc, unsigned long addr, int numa_node, size_t ip)
 {
-    caches_[proc % procs_per_node_]->cacheRead({addr, numa_node});
+    caches_[proc - first_proc_]->cacheWrite({addr, numa_node}, ip);
 }
 
-void NUMANode::cacheWrite(int proc, unsigned long addr, int numa_node)
+bool NUMANode::repeatHits(int proc, size_t addr, bool is_write, size_t count)
 {
-    caches_[proc % procs_per_node_]->cacheWrite({addr, numa_node});
+    return caches_[proc - first_proc_]->repeatHits(addr, is_write, count);
 }
 
 void NUMANode::emitCacheMsg(int src, Addr addr, CacheMsg msg_type, bool is_dirty)
 {
     if (msg_type == CacheMsg::NOP)
         return;
+    if (profiler_ && addr.node_id != node_id_)
+        profiler_->record(addr.addr, addr.node_id, LineEvent::GLOBAL);
+    if (traffic_)
+        traffic_->record(node_id_, addr.node_id, toMsgType(msg_type),
+                         msg_type == CacheMsg::DATA || (msg_type == CacheMsg::EVICTION && is_dirty));
+    if (msg_type == CacheMsg::BROADCAST && (llc_ || remote_cache_))
+        dropSharedElsewhere(addr.addr, node_id_);
+    if (snooping_)
+    {
+        // requests are broadcast on the local bus, data is one more bus transfer
+        if (msg_type != CacheMsg::DATA)
+            beginTransaction();
+        snoop_events_ += 1;
+    }
+    routeCacheMsg(src, addr, msg_type, is_dirty);
+}
+
+void NUMANode::beginTransaction()
+{
+    for (NUMANode *node : interconnects_)
+        node->snooped_ = false;
+    snooped_ = true;
+}
+
+void NUMANode::snoop(DirectoryMsg msg)
+{
+    switch (msg)
+    {
+    case DirectoryMsg::FETCH:
+    case DirectoryMsg::INVALIDATE:
+        // every cache on the bus sees one snoop, so it is paid once per request
+        if (!snooped_)
+            snoop_events_ += 1;
+        snooped_ = true;
+        break;
+    case DirectoryMsg::READDATA_EX:
+    case DirectoryMsg::READDATA:
+    case DirectoryMsg::WRITEDATA:
+        snoop_events_ += 1;
+        break;
+    }
+}
+
+void NUMANode::routeCacheMsg(int src, Addr addr, CacheMsg msg_type, bool is_dirty)
+{
     cache_events_ += 1;
     if (addr.node_id != node_id_)
     {
         global_events_ += 1;
-        interconnects_[addr.node_id]->emitCacheMsg(src, addr, msg_type, is_dirty);
+        interconnects_[addr.node_id]->routeCacheMsg(src, addr, msg_type, is_dirty);
     }
     else
         directory_->receiveMsg(src, addr.addr, msg_type, is_dirty);
 }
 
 void NUMANode::emitDirectoryMsg(int dst, size_t addr, DirectoryMsg msg, int request_node_id)
+{
+    if (profiler_)
+    {
+        if (msg == DirectoryMsg::INVALIDATE)
+            profiler_->record(addr, node_id_, LineEvent::INVALIDATION);
+        else if (msg == DirectoryMsg::FETCH)
+            profiler_->record(addr, node_id_, LineEvent::FETCH);
+        if (getNode(dst) != node_id_)
+            profiler_->record(addr, node_id_, LineEvent::GLOBAL);
+    }
+    if (traffic_)
+        traffic_->record(node_id_, getNode(dst), toMsgType(msg),
+                         msg == DirectoryMsg::READDATA || msg == DirectoryMsg::READDATA_EX ||
+                             msg == DirectoryMsg::WRITEDATA);
+    if ((msg == DirectoryMsg::READDATA_EX || msg == DirectoryMsg::WRITEDATA) && (llc_ || remote_cache_))
+        dropSharedElsewhere(addr, getNode(dst));
+    routeDirectoryMsg(dst, addr, msg, request_node_id);
+}
+
+void NUMANode::routeDirectoryMsg(int dst, size_t addr, DirectoryMsg msg, int request_node_id)
 {
     directory_events_ += 1;
     int dst_node;
     if ((dst_node = getNode(dst)) != node_id_)
     {
         global_events_ += 1;
-        interconnects_[dst_node]->emitDirectoryMsg(dst, addr, msg, request_node_id);
+        interconnects_[dst_node]->routeDirectoryMsg(dst, addr, msg, request_node_id);
     }
     else
-        caches_[dst % (num_procs_ / num_numa_nodes_)]->receiveMsg(addr, msg, request_node_id);
-}
\ No newline at end of file
+    {
+        if (snooping_)
+            snoop(msg);
+        if (msg == DirectoryMsg::INVALIDATE && (llc_ || remote_cache_))
+            dropShared(addr);
+        caches_[dst - first_proc_]->receiveMsg(addr, msg, request_node_id);
+    }
+}
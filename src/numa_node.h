@@ -2,10 +2,17 @@
 #include <vector>
 #include <stddef.h>
 #include "directory.h"
+#include "latencies.h"
+#include "shared_cache.h"
 
 struct Addr;
 enum class CacheMsg;
 enum class DirectoryMsg;
+class LineProfiler;
+class SharingAnalyzer;
+class TrafficMatrix;
+class CheckpointWriter;
+class CheckpointReader;
 
 struct NodeStats
 {
@@ -38,6 +45,13 @@ struct NodeStats
         memory_writes_ += other.memory_writes_;
         return *this;
     }
+
+    // serialized latency of everything counted so far, in ns
+    size_t latency() const
+    {
+        return hits_ * CACHE_LATENCY + (memory_reads_ + memory_writes_) * MEMORY_LATENCY +
+               local_events_ * LOCAL_INTERCONNECT_LATENCY + global_events_ * GLOBAL_INTERCONNECT_LATENCY;
+    }
 };
 
 // NUMA Node = Directory*1 + Processor(Cache)*N
@@ -49,8 +63,10 @@ public:
     void connectWith(NUMANode *node, int id);
 
     // operations
-    void cacheRead(int proc, size_t addr, int numa_node);
-    void cacheWrite(int proc, size_t addr, int numa_node);
+    void cacheRead(int proc, size_t addr, int numa_node, size_t ip = 0);
+    void cacheWrite(int proc, size_t addr, int numa_node, size_t ip = 0);
+    // see Cache::repeatHits
+    bool repeatHits(int proc, size_t addr, bool is_write, size_t count);
 
     // cache -> directory messages
     void emitCacheMsg(int src, Addr addr, CacheMsg msg_type, bool is_dirty = false);
@@ -58,28 +74,88 @@ public:
     // directory -> cache messages
     void emitDirectoryMsg(int dst, size_t addr, DirectoryMsg msg, int request_node_id = -1);
 
-    size_t getLocalEvents() const { return directory_events_ + cache_events_; }
+    // with snooping the local bus replaces the node-local directory messages
+    size_t getLocalEvents() const { return snooping_ ? snoop_events_ : getDirectoryLocalEvents(); }
+    size_t getDirectoryLocalEvents() const { return directory_events_ + cache_events_; }
+    size_t getSnoopEvents() const { return snoop_events_; }
     size_t getGlobalEvents() const { return global_events_; }
+    // global events of all connected nodes
+    size_t getMachineGlobalEvents() const;
+    size_t getCacheEvents() const { return cache_events_; }
+    size_t getDirectoryEvents() const { return directory_events_; }
+    size_t getMemoryReads() const { return directory_->getMemoryReads(); }
+    const std::vector<Cache *> &getCaches() const { return caches_; }
+    const Directory *getDirectory() const { return directory_; }
+
+    void attachProfiler(LineProfiler *profiler);
+    void attachAnalyzer(SharingAnalyzer *analyzer);
+    void attachTraffic(TrafficMatrix *traffic) { traffic_ = traffic; }
+    void enableSnooping() { snooping_ = true; }
+    void enableSilentEvictions();
+    void attachPrefetchers(PrefetchPolicy policy, int offset_len, int degree, int page_bits);
+
+    // a node-wide last level cache and a cache for lines homed on other
+    // nodes, both optional and owned by the node
+    void attachSharedCaches(SharedCache *llc, InclusionPolicy policy, SharedCache *remote_cache);
+    const SharedCache *getLLC() const { return llc_; }
+    const SharedCache *getRemoteCache() const { return remote_cache_; }
+
+    // private cache hooks: a read miss the shared caches may serve, a fill
+    // from a directory and a dropped private line
+    bool readShared(int src, Addr addr);
+    void fillShared(Addr addr);
+    void evictPrivate(Addr addr, bool dirty);
 
-    int getID();
+    // invalidate every cached line of [start, end) homed here, for page migration
+    size_t flushRange(size_t start, size_t end) { return directory_->flushRange(start, end); }
+    bool isSnooping() const { return snooping_; }
+
+    // directory, caches, shared caches and counters of this node
+    void save(CheckpointWriter &out) const;
+    void load(CheckpointReader &in);
+
+    int getID() const;
     NodeStats getStats(bool skip0) const;
     void printStats() const;
 
 private:
     int getNode(int dest);
 
+    // deliver a message or forward it to the node it is for
+    void routeCacheMsg(int src, Addr addr, CacheMsg msg_type, bool is_dirty);
+    void routeDirectoryMsg(int dst, size_t addr, DirectoryMsg msg, int request_node_id);
+    // a new request, every local bus has to be snooped again
+    void beginTransaction();
+    void snoop(DirectoryMsg msg);
+    // another node may write the line, the shared caches drop it
+    void insertLLC(size_t addr);
+    bool dropShared(size_t addr);
+    void dropSharedElsewhere(size_t addr, int writer_node);
+
     int node_id_;
     int num_numa_nodes_;
     int num_procs_;
-    int procs_per_node_;
+    int first_proc_; // id of caches_[0]
 
     Directory *directory_;
     std::vector<Cache *> caches_;
 
     std::vector<NUMANode *> interconnects_;
+    LineProfiler *profiler_;
+    TrafficMatrix *traffic_;
+
+    // caches snoop a local bus and only the home directory is consulted
+    // across nodes, the directory still tracks every line as a snoop filter
+    bool snooping_;
+    bool snooped_; // the current request was already seen on this bus
+
+    SharedCache *llc_;
+    InclusionPolicy llc_policy_;
+    SharedCache *remote_cache_;
 
     // metrics
     unsigned long cache_events_;
     unsigned long directory_events_;
     unsigned long global_events_;
+    unsigned long snoop_events_;
 };
@@ -0,0 +1,235 @@
+#include <algorithm>
+
+#include "interval_stats.h"
+#include "latencies.h"
+#include "machine.h"
+#include "numasim.h"
+
+Simulator::Simulator(const SimulatorConfig &config)
+    : config_(config),
+      affinity_(nullptr),
+      page_mapper_(nullptr),
+      migrator_(nullptr),
+      analyzer_(nullptr)
+{
+    if (config_.remap_threads)
+        affinity_ = new Affinity(config_.affinity, config_.procs, config_.numa_nodes);
+    build();
+}
+
+Simulator::~Simulator()
+{
+    destroy();
+    delete affinity_;
+}
+
+void Simulator::build()
+{
+    const SimulatorConfig &c = config_;
+    nodes_ = NewMachine(c.procs, c.numa_nodes, c.s, c.E, c.b, c.protocol);
+    for (NUMANode *node : nodes_)
+    {
+        if (c.snoop)
+            node->enableSnooping();
+        if (c.silent_evictions)
+            node->enableSilentEvictions();
+        if (c.llc || c.remote_cache)
+            node->attachSharedCaches(c.llc ? new SharedCache(c.llc_sets, c.llc_ways, c.b) : nullptr, c.llc_policy,
+                                     c.remote_cache ? new SharedCache(c.remote_cache_sets, c.remote_cache_ways, c.b)
+                                                    : nullptr);
+        if (c.prefetch != PrefetchPolicy::NONE)
+            node->attachPrefetchers(c.prefetch, c.b, c.prefetch_degree, prefetchPageBits());
+    }
+    if (c.remap_pages)
+        page_mapper_ = new PageMapper(c.placement, c.numa_nodes, c.page_size, c.preferred_node);
+    if (c.migrate)
+        migrator_ = new PageMigrator(nodes_, c.page_size, 1 << c.b, c.migrate_threshold, c.migrate_sample,
+                                     c.replicate);
+    analyzer_ = nullptr;
+}
+
+int Simulator::prefetchPageBits() const
+{
+    // the trace gives homes per OS page, placement policies and migration
+    // per page of page_size
+    if (!config_.migrate && (!config_.remap_pages || config_.placement == PlacementPolicy::TRACE))
+        return PREFETCH_PAGE_BITS;
+    int bits = 0;
+    while (((size_t)1 << (bits + 1)) <= config_.page_size)
+        bits += 1;
+    return std::min(bits, PREFETCH_PAGE_BITS);
+}
+
+void Simulator::destroy()
+{
+    delete page_mapper_;
+    delete migrator_;
+    page_mapper_ = nullptr;
+    migrator_ = nullptr;
+    for (NUMANode *node : nodes_)
+        delete node;
+    nodes_.clear();
+}
+
+void Simulator::reset()
+{
+    destroy();
+    build();
+    last_ = Placement();
+    sizes_ = AccessSizeStats();
+    atomics_ = AtomicStats();
+}
+
+void Simulator::attachAnalyzer(SharingAnalyzer *analyzer)
+{
+    analyzer_ = analyzer;
+    for (NUMANode *node : nodes_)
+        node->attachAnalyzer(analyzer);
+}
+
+std::string Simulator::loadAffinityMap(const std::string &path)
+{
+    if (affinity_ == nullptr || config_.affinity != AffinityPolicy::MAP)
+        return "the affinity policy is not map";
+    return affinity_->loadMap(path);
+}
+
+bool Simulator::access(int thread, size_t addr, char rw, int size, int node, size_t ip, size_t count,
+                       int end_node)
+{
+    int proc = affinity_ ? affinity_->proc(thread) : thread;
+    // the trace's nodes are used unless a placement policy other than trace
+    // replaces them, checked before the page mapper counts them
+    bool trace_homes = !page_mapper_ || config_.placement == PlacementPolicy::TRACE;
+    if (((node >= config_.numa_nodes || end_node >= config_.numa_nodes) && trace_homes) || proc < 0 ||
+        proc >= config_.procs)
+        return false;
+
+    // get the NUMA node that the requesting proc belongs to
+    int proc_node = procToNode(proc, config_.procs, config_.numa_nodes);
+    // a given home only holds for the page of addr, local placement for all
+    if (node < 0)
+    {
+        node = proc_node;
+        end_node = proc_node;
+    }
+
+    size_t first_line = addr >> config_.b;
+    size_t last_line = size > 1 ? (addr + size - 1) >> config_.b : first_line;
+    if (size > 0)
+    {
+        sizes_.sized_accesses += count;
+        sizes_.bytes += size * count;
+    }
+    sizes_.split_accesses += (last_line != first_line) * count;
+    sizes_.line_requests += (last_line - first_line + 1) * count;
+
+    for (size_t done = 0; done < count; ++done)
+    {
+        // the rest of a run only hits once the line is stable, in O(1). A
+        // migrator samples every access so it sees them one by one.
+        if (done > 0 && first_line == last_line && !migrator_ &&
+            nodes_[proc_node]->repeatHits(proc, addr, rw != 'R', count - done))
+        {
+            if (page_mapper_)
+                page_mapper_->home(addr, node, proc_node, count - done);
+            if (rw == 'A')
+            {
+                atomics_.atomics += count - done;
+                atomics_.owned += count - done;
+                atomics_.latency += (count - done) * CACHE_LATENCY;
+            }
+            break;
+        }
+        if (!accessLines(proc, proc_node, addr, rw, size, node, end_node, ip))
+            return false;
+    }
+    return true;
+}
+
+bool Simulator::accessLines(int proc, int proc_node, size_t addr, char rw, int size, int node, int end_node,
+                            size_t ip)
+{
+    size_t first_line = addr >> config_.b;
+    size_t last_line = size > 1 ? (addr + size - 1) >> config_.b : first_line;
+
+    NodeStats before;
+    if (rw == 'A')
+        before = getStats();
+
+    // one request per line, the home node given with the access is reused
+    // for all of them
+    for (size_t line = first_line; line <= last_line; ++line)
+    {
+        size_t start = line == first_line ? addr : line << config_.b;
+        int home = node;
+        if (start / config_.page_size != addr / config_.page_size)
+        {
+            // the trace's home is that of the first byte, a later page needs
+            // its own from the tracer or from a placement policy
+            bool last_page = start / config_.page_size == (addr + size - 1) / config_.page_size;
+            if (last_page && end_node >= 0)
+                home = end_node;
+            else if (!page_mapper_ || config_.placement == PlacementPolicy::TRACE)
+            {
+                sizes_.unresolved_lines++;
+                continue;
+            }
+        }
+        if (analyzer_)
+            analyzer_->setAccessSize(size > 0 ? std::min((line + 1) << config_.b, addr + size) - start : 0);
+        if (!accessLine(proc, proc_node, start, rw, home, ip))
+            return false;
+    }
+
+    if (rw == 'A')
+    {
+        NodeStats after = getStats();
+        atomics_.atomics++;
+        atomics_.owned += after.local_events_ == before.local_events_ && after.global_events_ == before.global_events_;
+        atomics_.latency += after.latency() - before.latency();
+    }
+    return true;
+}
+
+bool Simulator::accessLine(int proc, int proc_node, size_t addr, char rw, int node, size_t ip)
+{
+    if (page_mapper_)
+    {
+        node = page_mapper_->home(addr, node, proc_node);
+        if (node >= config_.numa_nodes)
+            return false;
+    }
+    if (migrator_)
+        node = migrator_->home(addr, node, proc_node, rw != 'R');
+
+    last_.proc = proc;
+    last_.proc_node = proc_node;
+    last_.home = node;
+    // an atomic takes the line exclusively like a write, in one request
+    // instead of a read that is upgraded later
+    if (rw == 'R')
+        nodes_[proc_node]->cacheRead(proc, addr, node, ip);
+    else
+        nodes_[proc_node]->cacheWrite(proc, addr, node, ip);
+    return true;
+}
+
+bool Simulator::access(const TraceRecord &record)
+{
+    return access(record.proc, record.addr, record.rw, record.size, record.node_id, record.ip, record.count,
+                  record.end_node);
+}
+
+size_t Simulator::access(const TraceRecord *records, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        if (!access(records[i]))
+            return i;
+    return count;
+}
+
+NodeStats Simulator::getStats() const
+{
+    return snapshotStats(nodes_);
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "affinity.h"
+#include "numa_node.h"
+#include "page_mapper.h"
+#include "page_migrator.h"
+#include "sharing_analyzer.h"
+#include "trace_reader.h"
+
+// everything that shapes the simulated machine
+struct SimulatorConfig
+{
+    // default to Intel L1 cache
+    int s = 6;
+    int E = 8;
+    int b = 6;
+    int procs = 1;
+    int numa_nodes = 1;
+    Protocol protocol = Protocol::MOESI;
+    bool snoop = false; // snoop inside nodes, directory only across nodes
+    bool silent_evictions = false;
+    PrefetchPolicy prefetch = PrefetchPolicy::NONE;
+    int prefetch_degree = 1;
+
+    bool remap_threads = false; // false runs thread i on proc i
+    AffinityPolicy affinity = AffinityPolicy::COMPACT;
+
+    bool remap_pages = false; // false keeps the given home nodes untouched
+    PlacementPolicy placement = PlacementPolicy::TRACE;
+    size_t page_size = 4096;
+    int preferred_node = 0;
+
+    bool migrate = false;
+    size_t migrate_threshold = 8; // samples before a page is reconsidered
+    size_t migrate_sample = 16;   // every Nth access is sampled
+    bool replicate = false;
+
+    bool llc = false; // one shared cache per node below the private caches
+    InclusionPolicy llc_policy = InclusionPolicy::INCLUSIVE;
+    int llc_sets = 10; // index bits
+    int llc_ways = 16;
+    bool remote_cache = false; // per node cache of lines homed elsewhere
+    int remote_cache_sets = 8;
+    int remote_cache_ways = 8;
+};
+
+// accesses with a size, which can span several lines
+struct AccessSizeStats
+{
+    size_t sized_accesses = 0;
+    size_t bytes = 0;
+    size_t split_accesses = 0;   // crossing at least one line boundary
+    size_t line_requests = 0;    // of all accesses, one per line touched
+    size_t unresolved_lines = 0; // on a page whose home is unknown, not simulated
+};
+
+// locked read-modify-writes, 'A' records
+struct AtomicStats
+{
+    size_t atomics = 0;
+    size_t owned = 0;   // the line was already exclusive, no message left the cache
+    size_t latency = 0; // modeled ns of the atomics alone
+};
+
+// where an access ran after the thread and page placement policies
+struct Placement
+{
+    int proc = 0;
+    int proc_node = 0;
+    int home = 0;
+};
+
+// The machine and its placement policies behind a small API, built into
+// libnumasim. The command line simulator drives it from a trace, other tools
+// can feed it accesses as they happen. Observers such as profilers are
+// attached to getNodes() directly.
+class Simulator
+{
+public:
+    explicit Simulator(const SimulatorConfig &config);
+    ~Simulator();
+
+    // thread i runs on the i-th proc in path, returns an error message, ""
+    // on success
+    std::string loadAffinityMap(const std::string &path);
+
+    // simulates one access of thread, rw is 'R', 'W' or 'A' for an atomic
+    // read-modify-write. An atomic is one exclusive fetch of the line that
+    // no other request can come between, which holds by construction as
+    // requests are simulated one at a time. An access of size bytes that
+    // crosses line boundaries becomes one request per line, size 0 touches
+    // only the line of addr. node is the home node of addr, a negative one
+    // leaves it to the placement policy or else puts the line on the node of
+    // the proc. node only holds for the page of addr, end_node is the home of
+    // the last byte's page. Lines on a page without a known home are skipped
+    // unless a placement policy other than trace decides. count repeats the
+    // access, once the line is in a state where the repeats only hit they are
+    // counted in O(1). False if the thread or the node does not exist on this
+    // machine.
+    bool access(int thread, size_t addr, char rw, int size = 0, int node = -1, size_t ip = 0, size_t count = 1,
+                int end_node = -1);
+    bool access(const TraceRecord &record);
+    // the number of records simulated, stops at the first one that does not fit
+    size_t access(const TraceRecord *records, size_t count);
+
+    // O(caches), latency() of the result is the modeled time so far
+    NodeStats getStats() const;
+    const AccessSizeStats &getAccessSizeStats() const { return sizes_; }
+    const AtomicStats &getAtomicStats() const { return atomics_; }
+    // continue the counts of a restored checkpoint
+    void setAccessSizeStats(const AccessSizeStats &stats) { sizes_ = stats; }
+    void setAtomicStats(const AtomicStats &stats) { atomics_ = stats; }
+    // an empty machine with zeroed counters and placements, observers have
+    // to be attached to the new nodes again
+    void reset();
+
+    const SimulatorConfig &getConfig() const { return config_; }
+    const std::vector<NUMANode *> &getNodes() const { return nodes_; }
+    const Placement &getLastPlacement() const { return last_; }
+    // attaches to every node and is told the bytes of every line request
+    void attachAnalyzer(SharingAnalyzer *analyzer);
+    Affinity *getAffinity() const { return affinity_; }
+    PageMapper *getPageMapper() const { return page_mapper_; }
+    PageMigrator *getMigrator() const { return migrator_; }
+
+private:
+    void build();
+    void destroy();
+    // how far prefetches may reach from the accessed page
+    int prefetchPageBits() const;
+    // one access, after the thread placement
+    bool accessLines(int proc, int proc_node, size_t addr, char rw, int size, int node, int end_node, size_t ip);
+    // one line of an access
+    bool accessLine(int proc, int proc_node, size_t addr, char rw, int node, size_t ip);
+
+    SimulatorConfig config_;
+    std::vector<NUMANode *> nodes_;
+    Affinity *affinity_;
+    PageMapper *page_mapper_;
+    PageMigrator *migrator_;
+    SharingAnalyzer *analyzer_;
+    Placement last_;
+    AccessSizeStats sizes_;
+    AtomicStats atomics_;
+};
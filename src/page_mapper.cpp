@@ -0,0 +1,137 @@
+#include <iomanip>
+
+#include "checkpoint.h"
+#include "page_mapper.h"
+
+const char *placementName(PlacementPolicy policy)
+{
+    switch (policy)
+    {
+    case PlacementPolicy::TRACE:
+        return "trace";
+    case PlacementPolicy::FIRST_TOUCH:
+        return "first-touch";
+    case PlacementPolicy::INTERLEAVE:
+        return "interleave";
+    case PlacementPolicy::PREFERRED:
+        return "preferred";
+    case PlacementPolicy::HASH:
+        return "hash";
+    }
+    return "unknown";
+}
+
+PageMapper::PageMapper(PlacementPolicy policy, int numa_nodes, size_t page_size, int preferred_node)
+    : policy_(policy),
+      numa_nodes_(numa_nodes),
+      page_bits_(0),
+      preferred_node_(preferred_node),
+      pages_per_node_(numa_nodes, 0),
+      local_accesses_(0),
+      remote_accesses_(0)
+{
+    while (((size_t)1 << (page_bits_ + 1)) <= page_size)
+        page_bits_ += 1;
+}
+
+int PageMapper::home(size_t addr, int trace_node, int requester_node, size_t accesses)
+{
+    size_t page = addr >> page_bits_;
+    auto it = pages_.find(page);
+    int node;
+    if (it != pages_.end() && policy_ != PlacementPolicy::TRACE)
+        node = it->second;
+    else
+    {
+        switch (policy_)
+        {
+        case PlacementPolicy::FIRST_TOUCH:
+            node = requester_node;
+            break;
+        case PlacementPolicy::INTERLEAVE:
+            node = page % numa_nodes_;
+            break;
+        case PlacementPolicy::PREFERRED:
+            node = preferred_node_;
+            break;
+        case PlacementPolicy::HASH:
+            // splitmix64 finalizer, spreads strided page numbers evenly
+            page ^= page >> 30;
+            page *= 0xbf58476d1ce4e5b9ULL;
+            page ^= page >> 27;
+            page *= 0x94d049bb133111ebULL;
+            page ^= page >> 31;
+            node = page % numa_nodes_;
+            break;
+        default:
+            // the trace may place the same page on different nodes
+            node = trace_node;
+            break;
+        }
+        if (it == pages_.end())
+        {
+            pages_.insert({addr >> page_bits_, node});
+            pages_per_node_[node] += 1;
+        }
+    }
+
+    if (node == requester_node)
+        local_accesses_ += accesses;
+    else
+        remote_accesses_ += accesses;
+    return node;
+}
+
+void PageMapper::save(CheckpointWriter &out) const
+{
+    out.put((uint64_t)policy_);
+    out.put(page_bits_);
+    out.put(pages_.size());
+    for (const auto &[page, node] : pages_)
+    {
+        out.put(page);
+        out.put(node);
+    }
+    for (size_t pages : pages_per_node_)
+        out.put(pages);
+    out.put(local_accesses_);
+    out.put(remote_accesses_);
+}
+
+bool PageMapper::load(CheckpointReader &in)
+{
+    if (in.get() != (uint64_t)policy_ || (int)in.get() != page_bits_)
+        return false;
+    size_t pages = in.get();
+    for (size_t i = 0; i < pages && in.ok(); ++i)
+    {
+        size_t page = in.get();
+        pages_[page] = in.get();
+    }
+    for (size_t &node_pages : pages_per_node_)
+        node_pages = in.get();
+    local_accesses_ = in.get();
+    remote_accesses_ = in.get();
+    return true;
+}
+
+void PageMapper::printReport(std::ostream &out) const
+{
+    size_t accesses = local_accesses_ + remote_accesses_;
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+
+    out << "\t** Page Placement (" << placementName(policy_) << ", " << ((size_t)1 << page_bits_)
+        << " byte pages) ***\n\n"
+        << "Pages:\t\t\t" << pages_.size() << "\n"
+        << "Local Accesses:\t\t" << local_accesses_ << "\t("
+        << (accesses ? 100.0 * local_accesses_ / accesses : 0.0) << "%)\n"
+        << "Remote Accesses:\t" << remote_accesses_ << "\t("
+        << (accesses ? 100.0 * remote_accesses_ / accesses : 0.0) << "%)\n";
+    for (int node = 0; node < numa_nodes_; ++node)
+        out << "Pages On Node " << node << ":\t" << pages_per_node_[node] << "\n";
+    out << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// where a page is placed, mirroring the numactl policies
+enum class PlacementPolicy
+{
+    TRACE,       // the node recorded in the trace
+    FIRST_TOUCH, // the node of the first processor to access the page
+    INTERLEAVE,  // round robin over the nodes
+    PREFERRED,   // one node for every page
+    HASH         // a hash of the page number
+};
+
+const char *placementName(PlacementPolicy policy);
+
+// Decides the home node of every access in place of the trace, so placement
+// policies can be compared on the same trace. Pages are page_size bytes, which
+// is also the interleave granularity.
+class PageMapper
+{
+public:
+    PageMapper(PlacementPolicy policy, int numa_nodes, size_t page_size, int preferred_node);
+
+    // home node of addr, requester_node is the node of the accessing proc,
+    // counted as accesses local or remote accesses
+    int home(size_t addr, int trace_node, int requester_node, size_t accesses = 1);
+
+    // placed pages, false if the checkpoint used another policy or page size
+    void save(CheckpointWriter &out) const;
+    bool load(CheckpointReader &in);
+
+    void printReport(std::ostream &out) const;
+
+private:
+    PlacementPolicy policy_;
+    int numa_nodes_;
+    int page_bits_;
+    int preferred_node_;
+
+    // placed pages, first touch needs them and the report counts them
+    std::unordered_map<size_t, int> pages_;
+    std::vector<size_t> pages_per_node_;
+    size_t local_accesses_, remote_accesses_;
+};
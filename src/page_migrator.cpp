@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "checkpoint.h"
+#include "page_migrator.h"
+#include "numa_node.h"
+#include "latencies.h"
+
+PageMigrator::PageMigrator(const std::vector<NUMANode *> &nodes, size_t page_size, int line_size, size_t threshold,
+                           size_t sample_period, bool replicate)
+    : nodes_(nodes),
+      page_bits_(0),
+      lines_per_page_(page_size / line_size),
+      threshold_(threshold),
+      sample_period_(sample_period),
+      replicate_(replicate),
+      sampler_(0x9e3779b97f4a7c15ULL),
+      migrations_(0),
+      replications_(0),
+      collapses_(0),
+      shootdowns_(0),
+      copied_pages_(0),
+      flushed_lines_(0),
+      local_accesses_(0),
+      remote_accesses_(0),
+      replica_reads_(0)
+{
+    while (((size_t)1 << (page_bits_ + 1)) <= page_size)
+        page_bits_ += 1;
+}
+
+int PageMigrator::home(size_t addr, int home, int requester_node, bool is_write)
+{
+    size_t page = addr >> page_bits_;
+    Page &state = pages_[page];
+    // placement is fixed per page from here on, the migrator moves it
+    if (state.home == -1)
+    {
+        state.home = home;
+        state.samples.resize(nodes_.size(), 0);
+    }
+
+    if (is_write && state.replicated)
+        collapse(page, state);
+
+    sampler_ ^= sampler_ << 13;
+    sampler_ ^= sampler_ >> 7;
+    sampler_ ^= sampler_ << 17;
+    if (sampler_ % sample_period_ == 0)
+    {
+        state.samples[requester_node] += 1;
+        state.written |= is_write;
+        decide(page, state);
+    }
+
+    int node = state.home;
+    if (state.replicated && !is_write && requester_node != state.home)
+    {
+        // the first read on a node makes its copy
+        if (!(state.replicas & ((uint64_t)1 << requester_node)))
+        {
+            state.replicas |= (uint64_t)1 << requester_node;
+            replications_ += 1;
+            copied_pages_ += 1;
+        }
+        node = requester_node;
+        replica_reads_ += 1;
+    }
+
+    if (node == requester_node)
+        local_accesses_ += 1;
+    else
+        remote_accesses_ += 1;
+    return node;
+}
+
+void PageMigrator::decide(size_t page, Page &state)
+{
+    size_t total = 0;
+    int readers = 0;
+    for (size_t samples : state.samples)
+    {
+        total += samples;
+        readers += samples > 0;
+    }
+    if (total < threshold_)
+        return;
+
+    int dominant = std::max_element(state.samples.begin(), state.samples.end()) - state.samples.begin();
+    if (replicate_ && !state.written && readers > 1 && nodes_.size() <= 64)
+    {
+        // only sampled writes are known, a line written before the window
+        // can still be dirty in a cache, so the home is cleaned before any
+        // replica serves a read and the page is mapped read-only everywhere
+        flushed_lines_ += flush(page, state.home);
+        state.replicated = true;
+        shootdowns_ += 1;
+    }
+    else if (dominant != state.home && 2 * state.samples[dominant] > total)
+    {
+        flushed_lines_ += flush(page, state.home);
+        if (state.replicated)
+            collapse(page, state);
+        state.home = dominant;
+        migrations_ += 1;
+        copied_pages_ += 1;
+        shootdowns_ += 1;
+    }
+    std::fill(state.samples.begin(), state.samples.end(), 0);
+    state.written = false;
+}
+
+size_t PageMigrator::flush(size_t page, int node)
+{
+    return nodes_[node]->flushRange(page << page_bits_, (page + 1) << page_bits_);
+}
+
+// a write makes the copies stale, they are dropped before it happens
+void PageMigrator::collapse(size_t page, Page &state)
+{
+    for (size_t node = 0; node < nodes_.size(); ++node)
+        if (state.replicas & ((uint64_t)1 << node))
+            flushed_lines_ += flush(page, node);
+    state.replicas = 0;
+    state.replicated = false;
+    collapses_ += 1;
+    shootdowns_ += 1;
+}
+
+void PageMigrator::save(CheckpointWriter &out) const
+{
+    out.put(page_bits_);
+    out.put(sampler_);
+    out.put(pages_.size());
+    for (const auto &[page, state] : pages_)
+    {
+        out.put(page);
+        out.putSigned(state.home);
+        out.put(state.replicated);
+        out.put(state.written);
+        out.put(state.replicas);
+        for (size_t samples : state.samples)
+            out.put(samples);
+    }
+    for (size_t counter : {migrations_, replications_, collapses_, shootdowns_, copied_pages_, flushed_lines_,
+                           local_accesses_, remote_accesses_, replica_reads_})
+        out.put(counter);
+}
+
+bool PageMigrator::load(CheckpointReader &in)
+{
+    if ((int)in.get() != page_bits_)
+        return false;
+    sampler_ = in.get();
+    size_t pages = in.get();
+    for (size_t i = 0; i < pages && in.ok(); ++i)
+    {
+        Page &state = pages_[in.get()];
+        state.home = in.getSigned();
+        state.replicated = in.get();
+        state.written = in.get();
+        state.replicas = in.get();
+        state.samples.resize(nodes_.size());
+        for (size_t &samples : state.samples)
+            samples = in.get();
+    }
+    for (size_t *counter : {&migrations_, &replications_, &collapses_, &shootdowns_, &copied_pages_,
+                            &flushed_lines_, &local_accesses_, &remote_accesses_, &replica_reads_})
+        *counter = in.get();
+    return true;
+}
+
+size_t PageMigrator::getCostLatency() const
+{
+    // every line of a copied page is read, sent to the other node and written
+    size_t copy = copied_pages_ * lines_per_page_ * (2 * MEMORY_LATENCY + GLOBAL_INTERCONNECT_LATENCY);
+    return copy + shootdowns_ * TLB_SHOOTDOWN_LATENCY;
+}
+
+void PageMigrator::printReport(std::ostream &out) const
+{
+    size_t accesses = local_accesses_ + remote_accesses_;
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+
+    out << "\t** Page Migration ***\n\n"
+        << "Pages Seen:\t\t" << pages_.size() << "\n"
+        << "Migrations:\t\t" << migrations_ << "\n"
+        << "Replicas Made:\t\t" << replications_ << "\n"
+        << "Replica Reads:\t\t" << replica_reads_ << "\n"
+        << "Replica Collapses:\t" << collapses_ << "\n"
+        << "TLB Shootdowns:\t\t" << shootdowns_ << "\n"
+        << "Pages Copied:\t\t" << copied_pages_ << "\n"
+        << "Lines Flushed:\t\t" << flushed_lines_ << "\n"
+        << "Local Accesses:\t\t" << local_accesses_ << "\t("
+        << (accesses ? 100.0 * local_accesses_ / accesses : 0.0) << "%)\n"
+        << "Remote Accesses:\t" << remote_accesses_ << "\t("
+        << (accesses ? 100.0 * remote_accesses_ / accesses : 0.0) << "%)\n"
+        << "Copy Latency:\t\t"
+        << outputLatency(copied_pages_ * lines_per_page_ * (2 * MEMORY_LATENCY + GLOBAL_INTERCONNECT_LATENCY))
+        << "\n"
+        << "Shootdown Latency:\t" << outputLatency(shootdowns_ * TLB_SHOOTDOWN_LATENCY) << "\n"
+        << "Migration Cost Latency:\t" << outputLatency(getCostLatency()) << "\n"
+        << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+
+class NUMANode;
+class CheckpointWriter;
+class CheckpointReader;
+
+// AutoNUMA-style placement that changes while the trace runs. Every sample
+// access is charged to its page, a page whose samples are dominated by one
+// remote node is migrated there and, with replication, a page read by several
+// nodes without writes gets a read-only copy on each reader's node.
+class PageMigrator
+{
+public:
+    PageMigrator(const std::vector<NUMANode *> &nodes, size_t page_size, int line_size, size_t threshold,
+                 size_t sample_period, bool replicate);
+
+    // the node serving this access, home is where the page was placed
+    int home(size_t addr, int home, int requester_node, bool is_write);
+
+    // modeled cost of the copies and shootdowns, the flushes are ordinary messages
+    size_t getCostLatency() const;
+    // page states and samples, false if the checkpoint used another page size
+    void save(CheckpointWriter &out) const;
+    bool load(CheckpointReader &in);
+    void printReport(std::ostream &out) const;
+
+private:
+    struct Page
+    {
+        int home = -1;
+        bool replicated = false;
+        bool written = false;  // a sampled write since the last decision
+        uint64_t replicas = 0; // nodes holding a read-only copy
+        std::vector<size_t> samples;
+    };
+
+    void decide(size_t page, Page &state);
+    size_t flush(size_t page, int node);
+    void collapse(size_t page, Page &state);
+
+    const std::vector<NUMANode *> &nodes_;
+    int page_bits_;
+    size_t lines_per_page_;
+    size_t threshold_;
+    size_t sample_period_;
+    bool replicate_;
+
+    uint64_t sampler_; // xorshift state, a fixed period would alias with the trace
+    std::unordered_map<size_t, Page> pages_;
+
+    // metrics
+    size_t migrations_, replications_, collapses_, shootdowns_, copied_pages_, flushed_lines_;
+    size_t local_accesses_, remote_accesses_, replica_reads_;
+};
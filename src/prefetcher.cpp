@@ -0,0 +1,175 @@
+#include <algorithm>
+
+#include "checkpoint.h"
+#include "prefetcher.h"
+
+void NextLinePrefetcher::observe(size_t addr, size_t, bool trigger, std::vector<size_t> &lines)
+{
+    if (!trigger)
+        return;
+    size_t line = addr >> offset_len_;
+    for (int i = 1; i <= degree_; ++i)
+        lines.push_back((line + i) << offset_len_);
+}
+
+IpStridePrefetcher::IpStridePrefetcher(int offset_len, int degree)
+    : Prefetcher(offset_len, degree),
+      table_(TABLE_SIZE) {}
+
+void IpStridePrefetcher::observe(size_t addr, size_t ip, bool, std::vector<size_t> &lines)
+{
+    // without ip= in the trace there is nothing to index the table with
+    if (ip == 0)
+        return;
+
+    Entry &entry = table_[(ip ^ (ip >> 8)) % TABLE_SIZE];
+    if (entry.ip != ip)
+    {
+        entry = Entry();
+        entry.ip = ip;
+        entry.last_addr = addr;
+        return;
+    }
+
+    long stride = (long)(addr - entry.last_addr);
+    entry.last_addr = addr;
+    if (stride != 0 && stride == entry.stride)
+        entry.confidence = std::min(entry.confidence + 1, 3);
+    else
+    {
+        entry.confidence = std::max(entry.confidence - 1, 0);
+        if (entry.confidence == 0)
+            entry.stride = stride;
+        return;
+    }
+    if (entry.confidence < 2)
+        return;
+
+    // strides smaller than a line would prefetch the same line repeatedly
+    size_t last_line = addr >> offset_len_;
+    for (int i = 1; i <= degree_; ++i)
+    {
+        size_t line = (addr + stride * i) >> offset_len_;
+        if (line == last_line)
+            continue;
+        lines.push_back(line << offset_len_);
+        last_line = line;
+    }
+}
+
+void IpStridePrefetcher::save(CheckpointWriter &out) const
+{
+    for (const Entry &entry : table_)
+    {
+        out.put(entry.ip);
+        if (entry.ip == 0)
+            continue;
+        out.put(entry.last_addr);
+        out.putSigned(entry.stride);
+        out.put(entry.confidence);
+    }
+}
+
+void IpStridePrefetcher::load(CheckpointReader &in)
+{
+    for (Entry &entry : table_)
+    {
+        entry = Entry();
+        entry.ip = in.get();
+        if (entry.ip == 0)
+            continue;
+        entry.last_addr = in.get();
+        entry.stride = in.getSigned();
+        entry.confidence = in.get();
+    }
+}
+
+StreamPrefetcher::StreamPrefetcher(int offset_len, int degree)
+    : Prefetcher(offset_len, degree),
+      streams_(STREAMS),
+      time_(0) {}
+
+void StreamPrefetcher::observe(size_t addr, size_t, bool trigger, std::vector<size_t> &lines)
+{
+    if (!trigger)
+        return;
+    time_ += 1;
+    size_t line = addr >> offset_len_;
+
+    Stream *lru = &streams_[0];
+    for (Stream &stream : streams_)
+    {
+        if (!stream.valid)
+        {
+            lru = &stream;
+            continue;
+        }
+        long distance = (long)(line - stream.line);
+        if (distance != 0 && distance >= -WINDOW && distance <= WINDOW)
+        {
+            int direction = distance > 0 ? 1 : -1;
+            stream.confirmed = direction == stream.direction;
+            stream.direction = direction;
+            stream.line = line;
+            stream.last_used = time_;
+            if (stream.confirmed)
+                for (int i = 1; i <= degree_; ++i)
+                    lines.push_back((line + direction * i) << offset_len_);
+            return;
+        }
+        if (lru->valid && stream.last_used < lru->last_used)
+            lru = &stream;
+    }
+
+    *lru = Stream();
+    lru->valid = true;
+    lru->line = line;
+    lru->last_used = time_;
+}
+
+void StreamPrefetcher::save(CheckpointWriter &out) const
+{
+    out.put(time_);
+    for (const Stream &stream : streams_)
+    {
+        out.put(stream.valid);
+        if (!stream.valid)
+            continue;
+        out.put(stream.line);
+        out.putSigned(stream.direction);
+        out.put(stream.confirmed);
+        out.put(stream.last_used);
+    }
+}
+
+void StreamPrefetcher::load(CheckpointReader &in)
+{
+    time_ = in.get();
+    for (Stream &stream : streams_)
+    {
+        stream = Stream();
+        stream.valid = in.get();
+        if (!stream.valid)
+            continue;
+        stream.line = in.get();
+        stream.direction = in.getSigned();
+        stream.confirmed = in.get();
+        stream.last_used = in.get();
+    }
+}
+
+Prefetcher *NewPrefetcher(PrefetchPolicy policy, int offset_len, int degree)
+{
+    switch (policy)
+    {
+    case PrefetchPolicy::NEXT_LINE:
+        return new NextLinePrefetcher(offset_len, degree);
+    case PrefetchPolicy::IP_STRIDE:
+        return new IpStridePrefetcher(offset_len, degree);
+    case PrefetchPolicy::STREAM:
+        return new StreamPrefetcher(offset_len, degree);
+    case PrefetchPolicy::NONE:
+        break;
+    }
+    return nullptr;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// hardware prefetchers do not cross pages, the home node is only known per
+// page, smaller placement pages shrink the boundary further
+static const int PREFETCH_PAGE_BITS = 12;
+
+enum class PrefetchPolicy
+{
+    NONE,
+    NEXT_LINE,
+    IP_STRIDE,
+    STREAM
+};
+
+// Decides which lines to prefetch after a demand access. trigger is true on a
+// miss and on the first use of a prefetched line, the accesses a tagged
+// prefetcher reacts to. Candidates are appended to lines as line addresses.
+class Prefetcher
+{
+public:
+    Prefetcher(int offset_len, int degree) : offset_len_(offset_len), degree_(degree) {}
+    virtual ~Prefetcher() {}
+
+    virtual void observe(size_t addr, size_t ip, bool trigger, std::vector<size_t> &lines) = 0;
+    virtual PrefetchPolicy getPolicy() const = 0;
+
+    // training state for checkpoints, a stateless prefetcher saves nothing
+    virtual void save(CheckpointWriter &) const {}
+    virtual void load(CheckpointReader &) {}
+
+protected:
+    int offset_len_;
+    int degree_; // lines fetched per trigger
+};
+
+// the next degree lines after every trigger
+class NextLinePrefetcher : public Prefetcher
+{
+public:
+    using Prefetcher::Prefetcher;
+    void observe(size_t addr, size_t ip, bool trigger, std::vector<size_t> &lines) override;
+    PrefetchPolicy getPolicy() const override { return PrefetchPolicy::NEXT_LINE; }
+};
+
+// Per instruction stride detection: a table indexed by ip remembers the last
+// address and stride, and prefetches once the same stride was seen three
+// times in a row. A different stride lowers the confidence before replacing it.
+class IpStridePrefetcher : public Prefetcher
+{
+public:
+    IpStridePrefetcher(int offset_len, int degree);
+    void observe(size_t addr, size_t ip, bool trigger, std::vector<size_t> &lines) override;
+    PrefetchPolicy getPolicy() const override { return PrefetchPolicy::IP_STRIDE; }
+    void save(CheckpointWriter &out) const override;
+    void load(CheckpointReader &in) override;
+
+private:
+    static const size_t TABLE_SIZE = 256;
+    struct Entry
+    {
+        size_t ip = 0;
+        size_t last_addr = 0;
+        long stride = 0;
+        int confidence = 0;
+    };
+    std::vector<Entry> table_;
+};
+
+// Tracks a few ascending or descending miss streams and runs degree lines
+// ahead of a stream once two misses confirmed its direction.
+class StreamPrefetcher : public Prefetcher
+{
+public:
+    StreamPrefetcher(int offset_len, int degree);
+    void observe(size_t addr, size_t ip, bool trigger, std::vector<size_t> &lines) override;
+    PrefetchPolicy getPolicy() const override { return PrefetchPolicy::STREAM; }
+    void save(CheckpointWriter &out) const override;
+    void load(CheckpointReader &in) override;
+
+private:
+    static const size_t STREAMS = 16;
+    static const long WINDOW = 4; // lines a miss may be from a stream's head
+    struct Stream
+    {
+        size_t line = 0; // last line seen, as a line number
+        int direction = 0;
+        bool confirmed = false;
+        size_t last_used = 0;
+        bool valid = false;
+    };
+    std::vector<Stream> streams_;
+    size_t time_;
+};
+
+// nullptr for PrefetchPolicy::NONE
+Prefetcher *NewPrefetcher(PrefetchPolicy policy, int offset_len, int degree);
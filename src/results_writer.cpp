@@ -0,0 +1,274 @@
+#include "results_writer.h"
+#include "latencies.h"
+
+std::string JsonResultsWriter::quote(const std::string &s)
+{
+    std::string res = "\"";
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case '"':
+            res += "\\\"";
+            break;
+        case '\\':
+            res += "\\\\";
+            break;
+        case '\n':
+            res += "\\n";
+            break;
+        case '\t':
+            res += "\\t";
+            break;
+        default:
+            res += c;
+        }
+    }
+    return res + "\"";
+}
+
+void JsonResultsWriter::key(const std::string &k)
+{
+    if (!first_.back())
+        out_ << ",";
+    first_.back() = false;
+    if (!k.empty())
+        out_ << quote(k) << ":";
+}
+
+void JsonResultsWriter::open(const std::string &k, char bracket)
+{
+    key(k);
+    out_ << bracket;
+    first_.push_back(true);
+}
+
+void JsonResultsWriter::close(char bracket)
+{
+    first_.pop_back();
+    out_ << bracket;
+}
+
+void JsonResultsWriter::field(const std::string &k, size_t value)
+{
+    key(k);
+    out_ << value;
+}
+
+void JsonResultsWriter::field(const std::string &k, const std::string &value)
+{
+    key(k);
+    out_ << quote(value);
+}
+
+void JsonResultsWriter::writeCacheStats(const CacheStats &stats)
+{
+    field("hits", stats.hits_);
+    field("misses", stats.misses_);
+    field("flushes", stats.flushes_);
+    field("evictions", stats.evictions_);
+    field("dirty_evictions", stats.dirty_evictions_);
+    field("invalidations", stats.invalidations_);
+    field("memory_writes", stats.memory_writes_);
+}
+
+void JsonResultsWriter::beginResults(const RunInfo &info)
+{
+    first_.push_back(true);
+    open("", '{');
+
+    open("metadata", '{');
+    field("simulator", std::string("NUMA-Cache-Sim"));
+    field("trace", info.trace);
+    field("command_line", info.command_line);
+    field("started_at", info.started_at);
+    close('}');
+
+    open("config", '{');
+    field("protocol", info.protocol);
+    field("local_coherence", info.local_coherence);
+    field("placement", info.placement);
+    field("affinity", info.affinity);
+    field("order", info.order);
+    field("processors", info.procs);
+    field("numa_nodes", info.numa_nodes);
+    field("index_bits", info.index_len);
+    field("sets", (size_t)1 << info.index_len);
+    field("associativity", info.ways);
+    field("offset_bits", info.offset_len);
+    field("line_size", (size_t)1 << info.offset_len);
+    open("latencies_ns", '{');
+    field("cache", CACHE_LATENCY);
+    field("memory", MEMORY_LATENCY);
+    field("local_interconnect", LOCAL_INTERCONNECT_LATENCY);
+    field("global_interconnect", GLOBAL_INTERCONNECT_LATENCY);
+    close('}');
+    close('}');
+}
+
+void JsonResultsWriter::writeAggregate(const std::string &name, const NodeStats &stats, size_t total_events)
+{
+    open(name, '{');
+    field("total_events", total_events);
+    field("hits", stats.hits_);
+    field("misses", stats.misses_);
+    field("flushes", stats.flushes_);
+    field("evictions", stats.evictions_);
+    field("dirty_evictions", stats.dirty_evictions_);
+    field("invalidations", stats.invalidations_);
+    field("local_events", stats.local_events_);
+    field("global_events", stats.global_events_);
+    field("memory_reads", stats.memory_reads_);
+    field("memory_writes", stats.memory_writes_);
+
+    open("latencies_ns", '{');
+    field("cache_access", stats.hits_ * CACHE_LATENCY);
+    field("memory_read", stats.memory_reads_ * MEMORY_LATENCY);
+    field("memory_write", stats.memory_writes_ * MEMORY_LATENCY);
+    field("local_events", stats.local_events_ * LOCAL_INTERCONNECT_LATENCY);
+    field("global_events", stats.global_events_ * GLOBAL_INTERCONNECT_LATENCY);
+    close('}');
+    close('}');
+}
+
+void JsonResultsWriter::beginNodes()
+{
+    open("nodes", '[');
+}
+
+void JsonResultsWriter::writeNode(const NUMANode &node)
+{
+    open("", '{');
+    field("id", node.getID());
+    field("cache_events", node.getCacheEvents());
+    field("directory_events", node.getDirectoryEvents());
+    field("global_events", node.getGlobalEvents());
+    if (node.isSnooping())
+        field("snoop_events", node.getSnoopEvents());
+    field("memory_reads", node.getMemoryReads());
+
+    open("caches", '[');
+    for (const Cache *cache : node.getCaches())
+    {
+        open("", '{');
+        field("id", cache->getID());
+        writeCacheStats(cache->getStats());
+        close('}');
+    }
+    close(']');
+    close('}');
+    // let consumers tailing the file see whole nodes as they arrive
+    out_ << "\n";
+}
+
+void JsonResultsWriter::endNodes()
+{
+    close(']');
+}
+
+void JsonResultsWriter::endResults()
+{
+    close('}');
+    first_.pop_back();
+    out_ << std::endl;
+}
+
+std::string CsvResultsWriter::quote(const std::string &s)
+{
+    if (s.find_first_of(",\"\n") == std::string::npos)
+        return s;
+    std::string res = "\"";
+    for (char c : s)
+    {
+        if (c == '"')
+            res += '"';
+        res += c;
+    }
+    return res + "\"";
+}
+
+void CsvResultsWriter::row(const std::string &section, int node, int cache, const std::string &metric, const std::string &value)
+{
+    out_ << section << ",";
+    if (node >= 0)
+        out_ << node;
+    out_ << ",";
+    if (cache >= 0)
+        out_ << cache;
+    out_ << "," << metric << "," << quote(value) << "\n";
+}
+
+void CsvResultsWriter::row(const std::string &section, int node, int cache, const std::string &metric, size_t value)
+{
+    row(section, node, cache, metric, std::to_string(value));
+}
+
+void CsvResultsWriter::writeCacheStats(const std::string &section, int node, int cache, const CacheStats &stats)
+{
+    row(section, node, cache, "hits", stats.hits_);
+    row(section, node, cache, "misses", stats.misses_);
+    row(section, node, cache, "flushes", stats.flushes_);
+    row(section, node, cache, "evictions", stats.evictions_);
+    row(section, node, cache, "dirty_evictions", stats.dirty_evictions_);
+    row(section, node, cache, "invalidations", stats.invalidations_);
+    row(section, node, cache, "memory_writes", stats.memory_writes_);
+}
+
+void CsvResultsWriter::beginResults(const RunInfo &info)
+{
+    out_ << "section,node,cache,metric,value\n";
+    row("metadata", -1, -1, "simulator", "NUMA-Cache-Sim");
+    row("metadata", -1, -1, "trace", info.trace);
+    row("metadata", -1, -1, "command_line", info.command_line);
+    row("metadata", -1, -1, "started_at", info.started_at);
+
+    row("config", -1, -1, "protocol", info.protocol);
+    row("config", -1, -1, "local_coherence", info.local_coherence);
+    row("config", -1, -1, "placement", info.placement);
+    row("config", -1, -1, "affinity", info.affinity);
+    row("config", -1, -1, "order", info.order);
+    row("config", -1, -1, "processors", info.procs);
+    row("config", -1, -1, "numa_nodes", info.numa_nodes);
+    row("config", -1, -1, "index_bits", info.index_len);
+    row("config", -1, -1, "sets", (size_t)1 << info.index_len);
+    row("config", -1, -1, "associativity", info.ways);
+    row("config", -1, -1, "offset_bits", info.offset_len);
+    row("config", -1, -1, "line_size", (size_t)1 << info.offset_len);
+    row("config", -1, -1, "cache_latency_ns", CACHE_LATENCY);
+    row("config", -1, -1, "memory_latency_ns", MEMORY_LATENCY);
+    row("config", -1, -1, "local_interconnect_latency_ns", LOCAL_INTERCONNECT_LATENCY);
+    row("config", -1, -1, "global_interconnect_latency_ns", GLOBAL_INTERCONNECT_LATENCY);
+}
+
+void CsvResultsWriter::writeAggregate(const std::string &name, const NodeStats &stats, size_t total_events)
+{
+    row(name, -1, -1, "total_events", total_events);
+    row(name, -1, -1, "hits", stats.hits_);
+    row(name, -1, -1, "misses", stats.misses_);
+    row(name, -1, -1, "flushes", stats.flushes_);
+    row(name, -1, -1, "evictions", stats.evictions_);
+    row(name, -1, -1, "dirty_evictions", stats.dirty_evictions_);
+    row(name, -1, -1, "invalidations", stats.invalidations_);
+    row(name, -1, -1, "local_events", stats.local_events_);
+    row(name, -1, -1, "global_events", stats.global_events_);
+    row(name, -1, -1, "memory_reads", stats.memory_reads_);
+    row(name, -1, -1, "memory_writes", stats.memory_writes_);
+    row(name, -1, -1, "cache_access_latency_ns", stats.hits_ * CACHE_LATENCY);
+    row(name, -1, -1, "memory_read_latency_ns", stats.memory_reads_ * MEMORY_LATENCY);
+    row(name, -1, -1, "memory_write_latency_ns", stats.memory_writes_ * MEMORY_LATENCY);
+    row(name, -1, -1, "local_events_latency_ns", stats.local_events_ * LOCAL_INTERCONNECT_LATENCY);
+    row(name, -1, -1, "global_events_latency_ns", stats.global_events_ * GLOBAL_INTERCONNECT_LATENCY);
+}
+
+void CsvResultsWriter::writeNode(const NUMANode &node)
+{
+    int id = node.getID();
+    row("node", id, -1, "cache_events", node.getCacheEvents());
+    row("node", id, -1, "directory_events", node.getDirectoryEvents());
+    row("node", id, -1, "global_events", node.getGlobalEvents());
+    if (node.isSnooping())
+        row("node", id, -1, "snoop_events", node.getSnoopEvents());
+    row("node", id, -1, "memory_reads", node.getMemoryReads());
+    for (const Cache *cache : node.getCaches())
+        writeCacheStats("cache", id, cache->getID(), cache->getStats());
+}
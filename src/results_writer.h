@@ -0,0 +1,93 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "numa_node.h"
+
+enum class OutputFormat
+{
+    TEXT,
+    JSON,
+    CSV
+};
+
+// everything needed to reproduce a run, written before any stats
+struct RunInfo
+{
+    std::string trace;
+    std::string command_line;
+    std::string started_at;
+    std::string protocol;
+    std::string local_coherence = "directory";
+    std::string placement = "trace";
+    std::string affinity = "compact";
+    std::string order = "trace"; // how the records were interleaved
+    int procs = 0, numa_nodes = 0, index_len = 0, ways = 0, offset_len = 0;
+};
+
+// Streams the results of a run in a machine-readable format. Nodes and caches
+// are written as they are visited, so nothing is buffered besides the nesting
+// needed to close the output correctly.
+class ResultsWriter
+{
+public:
+    explicit ResultsWriter(std::ostream &out) : out_(out) {}
+    virtual ~ResultsWriter() {}
+
+    virtual void beginResults(const RunInfo &info) = 0;
+    virtual void writeAggregate(const std::string &name, const NodeStats &stats, size_t total_events) = 0;
+    virtual void beginNodes() = 0;
+    virtual void writeNode(const NUMANode &node) = 0;
+    virtual void endNodes() = 0;
+    virtual void endResults() = 0;
+
+protected:
+    std::ostream &out_;
+};
+
+class JsonResultsWriter : public ResultsWriter
+{
+public:
+    explicit JsonResultsWriter(std::ostream &out) : ResultsWriter(out) {}
+
+    void beginResults(const RunInfo &info) override;
+    void writeAggregate(const std::string &name, const NodeStats &stats, size_t total_events) override;
+    void beginNodes() override;
+    void writeNode(const NUMANode &node) override;
+    void endNodes() override;
+    void endResults() override;
+
+private:
+    // minimal streaming json emitter, first_ tracks whether the enclosing
+    // object/array still needs a separating comma
+    void open(const std::string &key, char bracket);
+    void close(char bracket);
+    void key(const std::string &key);
+    void field(const std::string &key, size_t value);
+    void field(const std::string &key, const std::string &value);
+    void writeCacheStats(const CacheStats &stats);
+    static std::string quote(const std::string &s);
+
+    std::vector<bool> first_;
+};
+
+// one row per value: section,node,cache,metric,value
+class CsvResultsWriter : public ResultsWriter
+{
+public:
+    explicit CsvResultsWriter(std::ostream &out) : ResultsWriter(out) {}
+
+    void beginResults(const RunInfo &info) override;
+    void writeAggregate(const std::string &name, const NodeStats &stats, size_t total_events) override;
+    void beginNodes() override {}
+    void writeNode(const NUMANode &node) override;
+    void endNodes() override {}
+    void endResults() override { out_.flush(); }
+
+private:
+    void row(const std::string &section, int node, int cache, const std::string &metric, size_t value);
+    void row(const std::string &section, int node, int cache, const std::string &metric, const std::string &value);
+    void writeCacheStats(const std::string &section, int node, int cache, const CacheStats &stats);
+    static std::string quote(const std::string &s);
+};
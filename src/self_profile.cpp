@@ -0,0 +1,169 @@
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "self_profile.h"
+
+PerfCounters::PerfCounters()
+{
+#ifdef __linux__
+    struct Event
+    {
+        const char *name;
+        unsigned int type;
+        unsigned long long config;
+    };
+    const Event events[] = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"llc misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    };
+
+    for (const Event &event : events)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event.type;
+        attr.config = event.config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd < 0)
+        {
+            // some PMUs lack a counter, only give up if none can be opened
+            if (error_ == "")
+                error_ = std::string(event.name) + ": " + strerror(errno);
+            continue;
+        }
+        counters_.push_back({event.name, fd, 0});
+    }
+    if (!counters_.empty())
+        error_ = "";
+#else
+    error_ = "perf_event_open is only available on linux";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (Counter &counter : counters_)
+        close(counter.fd);
+#endif
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+    for (Counter &counter : counters_)
+    {
+        ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef __linux__
+    for (Counter &counter : counters_)
+    {
+        ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter.fd, &counter.value, sizeof(counter.value)) != sizeof(counter.value))
+            counter.value = 0;
+    }
+#endif
+}
+
+void PerfCounters::print(std::ostream &out) const
+{
+    if (!available())
+    {
+        out << "Hardware Counters:\tunavailable (" << error_ << ")\n";
+        return;
+    }
+    for (const Counter &counter : counters_)
+        out << std::left << std::setw(24) << (counter.name + ":") << std::right << counter.value << "\n";
+}
+
+SelfProfile::SelfProfile(bool perf_counters)
+    : current_(Phase::SETUP),
+      started_(Clock::now()),
+      last_(started_),
+      elapsed_(),
+      perf_(perf_counters ? new PerfCounters() : nullptr)
+{
+    if (perf_)
+        perf_->start();
+}
+
+SelfProfile::~SelfProfile()
+{
+    delete perf_;
+}
+
+void SelfProfile::switchTo(Phase phase)
+{
+    Clock::time_point now = Clock::now();
+    elapsed_[(size_t)current_] += now - last_;
+    last_ = now;
+    current_ = phase;
+}
+
+void SelfProfile::stop()
+{
+    switchTo(current_);
+    if (perf_)
+        perf_->stop();
+}
+
+void SelfProfile::print(std::ostream &out, size_t accesses)
+{
+    using Seconds = std::chrono::duration<double>;
+    double total = Seconds(last_ - started_).count();
+    double simulate = Seconds(elapsed_[(size_t)Phase::SIMULATE]).count();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "\t** Simulator Performance ***\n\n"
+        << "Accesses:\t\t" << accesses << "\n"
+        << "Wall Time:\t\t" << total << "s\n"
+        << "Accesses/s:\t\t" << std::setprecision(0) << (total > 0 ? accesses / total : 0) << "\n"
+        << "Simulate Accesses/s:\t" << (simulate > 0 ? accesses / simulate : 0) << "\n"
+        << std::setprecision(3);
+
+    const char *names[] = {"Setup", "Parse", "Simulate", "Report"};
+    for (size_t i = 0; i < (size_t)Phase::COUNT; ++i)
+    {
+        double t = Seconds(elapsed_[i]).count();
+        out << std::left << std::setw(24) << (std::string(names[i]) + " Time:") << std::right << t << "s";
+        if (total > 0)
+            out << "\t(" << std::setprecision(1) << 100 * t / total << "%)" << std::setprecision(3);
+        out << "\n";
+    }
+    // ru_maxrss is in kilobytes on linux
+    out << "Peak RSS:\t\t" << usage.ru_maxrss / 1024.0 << "MB\n";
+    out.flags(flags);
+    out.precision(precision);
+
+    if (perf_)
+        perf_->print(out);
+    out << std::endl;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// where the simulator spends its own time
+enum class Phase
+{
+    SETUP,
+    PARSE,
+    SIMULATE,
+    REPORT,
+    COUNT
+};
+
+// Hardware counters for this process from perf_event_open. Opening them fails
+// without CAP_PERFMON or with a strict perf_event_paranoid, in which case the
+// profile just reports why.
+class PerfCounters
+{
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    bool available() const { return error_ == ""; }
+    const std::string &getError() const { return error_; }
+
+    void start();
+    void stop();
+    void print(std::ostream &out) const;
+
+private:
+    struct Counter
+    {
+        std::string name;
+        int fd;
+        unsigned long long value;
+    };
+    std::vector<Counter> counters_;
+    std::string error_;
+};
+
+// Accumulates wall time per phase. switchTo is a single clock read so it is
+// cheap enough to call twice per access.
+class SelfProfile
+{
+public:
+    explicit SelfProfile(bool perf_counters);
+    ~SelfProfile();
+
+    void switchTo(Phase phase);
+    void stop();
+    void print(std::ostream &out, size_t accesses);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Phase current_;
+    Clock::time_point started_, last_;
+    Clock::duration elapsed_[(size_t)Phase::COUNT];
+    PerfCounters *perf_;
+};
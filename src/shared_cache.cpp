@@ -0,0 +1,140 @@
+#include "checkpoint.h"
+#include "shared_cache.h"
+
+SharedCache::SharedCache(int index_len, int ways, int offset_len)
+    : index_len_(index_len),
+      ways_(ways),
+      offset_len_(offset_len),
+      clock_(0),
+      lines_(((size_t)1 << index_len) * ways) {}
+
+SharedCache::Line *SharedCache::find(size_t line)
+{
+    return const_cast<Line *>(static_cast<const SharedCache *>(this)->find(line));
+}
+
+const SharedCache::Line *SharedCache::find(size_t line) const
+{
+    size_t set = line & (((size_t)1 << index_len_) - 1);
+    for (int i = 0; i < ways_; ++i)
+    {
+        const Line &entry = lines_[set * ways_ + i];
+        if (entry.valid && entry.line == line)
+            return &entry;
+    }
+    return nullptr;
+}
+
+bool SharedCache::contains(size_t addr) const
+{
+    return find(addr >> offset_len_) != nullptr;
+}
+
+void SharedCache::touch(size_t addr, bool remote)
+{
+    Line *entry = find(addr >> offset_len_);
+    if (entry == nullptr)
+        return;
+    entry->last_used = ++clock_;
+    stats_.hits_ += 1;
+    stats_.remote_hits_ += remote;
+}
+
+bool SharedCache::insert(size_t addr, size_t &victim)
+{
+    size_t line = addr >> offset_len_;
+    Line *entry = find(line);
+    if (entry != nullptr)
+    {
+        entry->last_used = ++clock_;
+        return false;
+    }
+
+    size_t set = line & (((size_t)1 << index_len_) - 1);
+    Line *lru = &lines_[set * ways_];
+    for (int i = 0; i < ways_; ++i)
+    {
+        Line &candidate = lines_[set * ways_ + i];
+        if (!candidate.valid)
+        {
+            lru = &candidate;
+            break;
+        }
+        if (candidate.last_used < lru->last_used)
+            lru = &candidate;
+    }
+
+    bool evicted = lru->valid;
+    if (evicted)
+    {
+        victim = lru->line << offset_len_;
+        stats_.evictions_ += 1;
+    }
+    lru->line = line;
+    lru->valid = true;
+    lru->last_used = ++clock_;
+    stats_.fills_ += 1;
+    return evicted;
+}
+
+bool SharedCache::remove(size_t addr)
+{
+    Line *entry = find(addr >> offset_len_);
+    if (entry == nullptr)
+        return false;
+    entry->valid = false;
+    return true;
+}
+
+bool SharedCache::invalidate(size_t addr)
+{
+    if (!remove(addr))
+        return false;
+    stats_.invalidations_ += 1;
+    return true;
+}
+
+void SharedCache::save(CheckpointWriter &out) const
+{
+    out.put(index_len_);
+    out.put(ways_);
+    out.put(clock_);
+    out.put(stats_.hits_);
+    out.put(stats_.remote_hits_);
+    out.put(stats_.misses_);
+    out.put(stats_.fills_);
+    out.put(stats_.evictions_);
+    out.put(stats_.invalidations_);
+    out.put(stats_.back_invalidations_);
+    for (const Line &entry : lines_)
+    {
+        out.put(entry.valid);
+        if (!entry.valid)
+            continue;
+        out.put(entry.line);
+        out.put(entry.last_used);
+    }
+}
+
+bool SharedCache::load(CheckpointReader &in)
+{
+    if ((int)in.get() != index_len_ || (int)in.get() != ways_)
+        return false;
+    clock_ = in.get();
+    stats_.hits_ = in.get();
+    stats_.remote_hits_ = in.get();
+    stats_.misses_ = in.get();
+    stats_.fills_ = in.get();
+    stats_.evictions_ = in.get();
+    stats_.invalidations_ = in.get();
+    stats_.back_invalidations_ = in.get();
+    for (Line &entry : lines_)
+    {
+        entry.valid = in.get();
+        if (!entry.valid)
+            continue;
+        entry.line = in.get();
+        entry.last_used = in.get();
+    }
+    return true;
+}
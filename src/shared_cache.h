@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// how a node's shared cache relates to the private caches above it
+enum class InclusionPolicy
+{
+    INCLUSIVE, // holds every privately cached line, evicting one back-invalidates it
+    EXCLUSIVE, // holds only lines the private caches evicted
+    NINE       // filled alongside the private caches, evicts independently
+};
+
+struct SharedCacheStats
+{
+    size_t hits_ = 0, remote_hits_ = 0, misses_ = 0, fills_ = 0, evictions_ = 0, invalidations_ = 0,
+           back_invalidations_ = 0;
+};
+
+// A node-wide cache of clean line addresses. It has no coherence state of its
+// own: the node drops lines from it whenever another node may have written
+// them, so a hit is always a valid shared copy.
+class SharedCache
+{
+public:
+    SharedCache(int index_len, int ways, int offset_len);
+
+    bool contains(size_t addr) const;
+    // counts a hit and makes the line most recently used
+    void touch(size_t addr, bool remote);
+    void countMiss() { stats_.misses_ += 1; }
+    // true if a valid line had to make room, its address is put in victim
+    bool insert(size_t addr, size_t &victim);
+    // remove moves a line out, invalidate drops it because it may be stale
+    bool remove(size_t addr);
+    bool invalidate(size_t addr);
+    void countBackInvalidation() { stats_.back_invalidations_ += 1; }
+
+    const SharedCacheStats &getStats() const { return stats_; }
+
+    void save(CheckpointWriter &out) const;
+    // false, leaving the cache empty, if the geometry differs
+    bool load(CheckpointReader &in);
+
+private:
+    struct Line
+    {
+        size_t line = 0;
+        size_t last_used = 0;
+        bool valid = false;
+    };
+
+    Line *find(size_t line);
+    const Line *find(size_t line) const;
+
+    int index_len_;
+    int ways_;
+    int offset_len_;
+    size_t clock_;
+    std::vector<Line> lines_; // ways_ consecutive entries per set
+    SharedCacheStats stats_;
+};
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "sharing_analyzer.h"
+
+SharingAnalyzer::SharingAnalyzer(int procs, int index_len, int ways, int offset_len, int access_size)
+    : procs_(procs),
+      offset_len_(offset_len),
+      access_size_(access_size),
+      default_access_size_(access_size),
+      chunk_size_(std::max<size_t>(1, ((size_t)1 << offset_len) / 64)),
+      shadow_capacity_(((size_t)1 << index_len) * ways),
+      misses_((size_t)MissClass::UPGRADE + 1, 0),
+      shadows_(procs) {}
+
+uint64_t SharingAnalyzer::chunkMask(size_t addr) const
+{
+    size_t line_size = (size_t)1 << offset_len_;
+    size_t offset = addr & (line_size - 1);
+    size_t end = std::min(offset + access_size_, line_size);
+    uint64_t mask = 0;
+    for (size_t chunk = offset / chunk_size_; chunk <= (end - 1) / chunk_size_; ++chunk)
+        mask |= (uint64_t)1 << chunk;
+    return mask;
+}
+
+SharingAnalyzer::LineInfo &SharingAnalyzer::getLine(size_t line)
+{
+    auto it = lines_.find(line);
+    if (it == lines_.end())
+    {
+        it = lines_.emplace(line, LineInfo()).first;
+        it->second.procs.resize(procs_);
+    }
+    return it->second;
+}
+
+// returns whether the line was present before this access
+bool SharingAnalyzer::touchShadow(int proc, size_t line)
+{
+    ShadowCache &shadow = shadows_[proc];
+    auto it = shadow.lines.find(line);
+    if (it != shadow.lines.end())
+    {
+        shadow.lru.splice(shadow.lru.begin(), shadow.lru, it->second);
+        return true;
+    }
+    shadow.lru.push_front(line);
+    shadow.lines[line] = shadow.lru.begin();
+    if (shadow.lines.size() > shadow_capacity_)
+    {
+        shadow.lines.erase(shadow.lru.back());
+        shadow.lru.pop_back();
+    }
+    return false;
+}
+
+void SharingAnalyzer::recordAccess(int proc, size_t addr, bool is_write, bool miss, bool upgrade)
+{
+    size_t line = addr >> offset_len_;
+    uint64_t mask = chunkMask(addr);
+    LineInfo &info = getLine(line);
+    ProcLine &mine = info.procs[proc];
+    bool in_shadow = touchShadow(proc, line);
+
+    if (miss)
+    {
+        MissClass cls;
+        if (!mine.seen)
+            cls = MissClass::COLD;
+        else if (mine.invalidated)
+            cls = (mine.written_since_inval & mask) ? MissClass::TRUE_SHARING : MissClass::FALSE_SHARING;
+        else
+            cls = in_shadow ? MissClass::CONFLICT : MissClass::CAPACITY;
+
+        misses_[(size_t)cls] += 1;
+        if (cls == MissClass::TRUE_SHARING)
+            info.true_sharing += 1;
+        else if (cls == MissClass::FALSE_SHARING)
+            info.false_sharing += 1;
+    }
+    else if (upgrade)
+    {
+        misses_[(size_t)MissClass::UPGRADE] += 1;
+    }
+
+    if (miss)
+    {
+        mine.invalidated = false;
+        mine.written_since_inval = 0;
+    }
+    mine.seen = true;
+    mine.touched |= mask;
+
+    if (is_write)
+    {
+        for (int i = 0; i < procs_; ++i)
+            if (i != proc && info.procs[i].invalidated)
+                info.procs[i].written_since_inval |= mask;
+    }
+}
+
+void SharingAnalyzer::recordInvalidation(int proc, size_t addr)
+{
+    LineInfo &info = getLine(addr >> offset_len_);
+    info.invalidations += 1;
+    info.procs[proc].invalidated = true;
+    info.procs[proc].written_since_inval = 0;
+}
+
+std::string SharingAnalyzer::describeChunks(uint64_t mask) const
+{
+    std::ostringstream res;
+    bool first = true;
+    for (size_t chunk = 0; chunk < 64; ++chunk)
+    {
+        if (!(mask >> chunk & 1))
+            continue;
+        size_t last = chunk;
+        while (last + 1 < 64 && (mask >> (last + 1) & 1))
+            last++;
+        res << (first ? "" : ",") << chunk * chunk_size_ << "-" << (last + 1) * chunk_size_ - 1;
+        first = false;
+        chunk = last;
+    }
+    return res.str();
+}
+
+void SharingAnalyzer::printReport(std::ostream &out, size_t k) const
+{
+    size_t total = 0;
+    for (size_t count : misses_)
+        total += count;
+
+    const char *names[] = {"Cold", "Capacity", "Conflict", "True Sharing", "False Sharing", "Upgrade"};
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "\t** Miss Classification ***\n\n";
+    for (size_t i = 0; i < misses_.size(); ++i)
+    {
+        out << std::left << std::setw(16) << (std::string(names[i]) + ":") << std::right
+            << std::setw(12) << misses_[i];
+        if (total > 0)
+            out << "\t" << std::fixed << std::setprecision(2) << 100.0 * misses_[i] / total << "%";
+        out << "\n";
+    }
+    out << "\n";
+    out.flags(flags);
+    out.precision(precision);
+
+    std::vector<std::pair<size_t, const LineInfo *>> worst;
+    for (const auto &[line, info] : lines_)
+        if (info.false_sharing > 0)
+            worst.push_back({line, &info});
+    k = std::min(k, worst.size());
+    std::partial_sort(worst.begin(), worst.begin() + k, worst.end(),
+                      [](const auto &a, const auto &b)
+                      { return a.second->false_sharing > b.second->false_sharing; });
+
+    out << "\t** Top " << k << " False Sharing Lines ***\n\n";
+    for (size_t i = 0; i < k; ++i)
+    {
+        const LineInfo &info = *worst[i].second;
+        out << "0x" << std::hex << (worst[i].first << offset_len_) << std::dec
+            << "\tfalse sharing misses: " << info.false_sharing
+            << "\ttrue sharing misses: " << info.true_sharing
+            << "\tinvalidations: " << info.invalidations << "\n";
+        for (int p = 0; p < procs_; ++p)
+            if (info.procs[p].seen)
+                out << "\tproc " << p << " bytes " << describeChunks(info.procs[p].touched) << "\n";
+    }
+    out << std::endl;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <list>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// the four Cs, with coherence misses split by whether the data was shared
+enum class MissClass
+{
+    COLD,
+    CAPACITY,
+    CONFLICT,
+    TRUE_SHARING,
+    FALSE_SHARING,
+    UPGRADE, // write to a line already held shared
+};
+
+// Tells true sharing from false sharing by remembering which bytes of a line
+// every processor touched. A line is split into at most 64 chunks, so lines
+// up to 64 bytes are tracked per byte.
+class SharingAnalyzer
+{
+public:
+    SharingAnalyzer(int procs, int index_len, int ways, int offset_len, int access_size);
+
+    // called once the access has been performed by the cache
+    void recordAccess(int proc, size_t addr, bool is_write, bool miss, bool upgrade);
+    // proc lost its copy of the line to another processor's write
+    void recordInvalidation(int proc, size_t addr);
+    // bytes touched by the accesses that follow, 0 goes back to the default
+    void setAccessSize(int size) { access_size_ = size > 0 ? size : default_access_size_; }
+
+    void printReport(std::ostream &out, size_t k) const;
+
+private:
+    struct ProcLine
+    {
+        uint64_t touched = 0;
+        uint64_t written_since_inval = 0; // by other procs
+        bool seen = false;
+        bool invalidated = false;
+    };
+
+    struct LineInfo
+    {
+        std::vector<ProcLine> procs;
+        size_t true_sharing = 0, false_sharing = 0, invalidations = 0;
+    };
+
+    // a fully associative LRU cache the size of a real one, a miss that hits
+    // here would not have happened without set conflicts
+    struct ShadowCache
+    {
+        std::list<size_t> lru;
+        std::unordered_map<size_t, std::list<size_t>::iterator> lines;
+    };
+
+    uint64_t chunkMask(size_t addr) const;
+    bool touchShadow(int proc, size_t line);
+    LineInfo &getLine(size_t line);
+    std::string describeChunks(uint64_t mask) const;
+
+    int procs_;
+    int offset_len_;
+    int access_size_;
+    int default_access_size_; // for traces without sz=
+    size_t chunk_size_;
+    size_t shadow_capacity_;
+
+    std::vector<size_t> misses_; // indexed by MissClass
+    std::unordered_map<size_t, LineInfo> lines_;
+    std::vector<ShadowCache> shadows_;
+};
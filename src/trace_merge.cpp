@@ -0,0 +1,168 @@
+#include <cstdint>
+
+#include "latencies.h"
+#include "trace_merge.h"
+
+const char *mergeOrderName(MergeOrder order)
+{
+    switch (order)
+    {
+    case MergeOrder::TIMESTAMP:
+        return "ts";
+    case MergeOrder::INSTRUCTIONS:
+        return "ic";
+    case MergeOrder::SIMULATED:
+        return "sim";
+    }
+    return "unknown";
+}
+
+TraceMerger::TraceMerger(RecordSource &source, MergeOrder order, size_t window, int threads)
+    : source_(source),
+      order_(order),
+      window_(window),
+      thread_count_(threads)
+{
+    reset();
+}
+
+void TraceMerger::reset()
+{
+    threads_.clear();
+    heads_ = {};
+    invalid_.clear();
+    idle_threads_ = thread_count_;
+    ahead_key_ = 0;
+    buffered_ = 0;
+    read_ = 0;
+    merged_ = 0;
+    exhausted_ = false;
+    last_thread_ = -1;
+}
+
+bool TraceMerger::readAhead()
+{
+    TraceRecord record;
+    if (!source_.next(record))
+    {
+        exhausted_ = true;
+        return false;
+    }
+    read_++;
+    if (record.proc < 0)
+    {
+        invalid_.push_back(record);
+        return true;
+    }
+    if (record.proc >= (int)threads_.size())
+        threads_.resize(record.proc + 1);
+    Thread &thread = threads_[record.proc];
+    thread.pending.push_back(record);
+    thread.sequence.push_back(read_);
+    buffered_++;
+    if (order_ == MergeOrder::TIMESTAMP)
+        ahead_key_ = record.ts;
+    else if (order_ == MergeOrder::INSTRUCTIONS)
+        ahead_key_ = record.ic;
+    else
+        // a simulated key is only known once the record is its thread's head
+        ahead_key_ = SIZE_MAX;
+    if (thread.pending.size() == 1)
+    {
+        // threads past the count are rejected by main, they were never idle
+        if (thread.seen || record.proc < thread_count_)
+            idle_threads_--;
+        thread.seen = true;
+        size_t key = pushHead(record.proc);
+        if (order_ == MergeOrder::SIMULATED)
+            ahead_key_ = key;
+    }
+    return true;
+}
+
+size_t TraceMerger::pushHead(int thread_id)
+{
+    Thread &thread = threads_[thread_id];
+    const TraceRecord &record = thread.pending.front();
+    Head head;
+    head.thread = thread_id;
+    head.sequence = thread.sequence.front();
+    if (order_ == MergeOrder::TIMESTAMP)
+        head.key = record.ts;
+    else if (order_ == MergeOrder::INSTRUCTIONS)
+        head.key = record.ic;
+    else
+    {
+        // the thread works through the instructions before the access first
+        size_t gap = record.ic > thread.last_ic ? record.ic - thread.last_ic : 0;
+        head.key = thread.clock + gap * INSTRUCTION_LATENCY;
+    }
+    heads_.push(head);
+    return head.key;
+}
+
+bool TraceMerger::next(TraceRecord &record)
+{
+    // the last thread's next record waited for its charge
+    if (last_thread_ >= 0)
+    {
+        if (threads_[last_thread_].pending.empty())
+            idle_threads_++;
+        else
+            pushHead(last_thread_);
+        last_thread_ = -1;
+    }
+
+    // a thread with nothing pending, or one that has not shown up yet, could
+    // still have the earliest record, as could the records after one that is
+    // not past the earliest head
+    while (!exhausted_ &&
+           (heads_.empty() || (buffered_ < window_ && (idle_threads_ > 0 || ahead_key_ <= heads_.top().key))))
+        readAhead();
+
+    if (!invalid_.empty())
+    {
+        record = invalid_.front();
+        invalid_.pop_front();
+        return true;
+    }
+    if (heads_.empty())
+        return false;
+
+    Head head = heads_.top();
+    heads_.pop();
+    Thread &thread = threads_[head.thread];
+    record = thread.pending.front();
+    thread.pending.pop_front();
+    thread.sequence.pop_front();
+    buffered_--;
+    merged_++;
+    if (order_ == MergeOrder::SIMULATED)
+    {
+        thread.clock = head.key;
+        thread.last_ic = record.ic;
+    }
+    last_thread_ = head.thread;
+    return true;
+}
+
+void TraceMerger::charge(size_t latency)
+{
+    if (last_thread_ >= 0)
+        threads_[last_thread_].clock += latency;
+}
+
+bool TraceMerger::seek(size_t offset, size_t)
+{
+    if (!source_.seek(0, 0))
+        return false;
+    reset();
+    // the simulated order depends on latencies a checkpoint does not have
+    if (offset > 0 && order_ == MergeOrder::SIMULATED)
+        return false;
+    TraceRecord record;
+    while (merged_ < offset)
+        if (!next(record))
+            return false;
+    return true;
+}
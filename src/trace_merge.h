@@ -0,0 +1,82 @@
+#pragma once
+#include <deque>
+#include <queue>
+#include <vector>
+#include <stddef.h>
+
+#include "trace_reader.h"
+
+// what the per-thread streams of a trace are merged by
+enum class MergeOrder
+{
+    TIMESTAMP,    // ts=, the recorded time of every access
+    INSTRUCTIONS, // ic=, threads progress at the same instruction rate
+    SIMULATED     // each thread's modeled latency plus its ic= gaps
+};
+
+const char *mergeOrderName(MergeOrder order);
+
+// Rebuilds the interleaving of a trace instead of taking the order in which
+// the tracer's threads happened to get its lock. The records of every thread
+// stay in program order and a k-way heap over the threads' next records picks
+// the earliest one. A thread's next record, or the first record of a thread
+// not seen yet, can still be further down the trace, so records are read
+// ahead until every one of the threads has one waiting and the last record
+// read is past the earliest head, or window records are buffered. Records
+// without the field keep their trace order.
+class TraceMerger : public RecordSource
+{
+public:
+    TraceMerger(RecordSource &source, MergeOrder order, size_t window, int threads);
+
+    bool next(TraceRecord &record) override;
+    size_t getLineNumber() const override { return source_.getLineNumber(); }
+
+    // the number of merged records, seek merges again from the start so only
+    // the recorded orders can continue a checkpoint
+    size_t tell() override { return merged_; }
+    bool seek(size_t offset, size_t line_no) override;
+
+    bool timed() const override { return order_ == MergeOrder::SIMULATED; }
+    void charge(size_t latency) override;
+
+private:
+    struct Thread
+    {
+        std::deque<TraceRecord> pending; // in program order
+        std::deque<size_t> sequence;     // trace position of every pending record
+        bool seen = false;
+        size_t clock = 0; // simulated ns, SIMULATED only
+        size_t last_ic = 0;
+    };
+
+    struct Head
+    {
+        size_t key, sequence;
+        int thread;
+        bool operator>(const Head &other) const
+        {
+            return key != other.key ? key > other.key : sequence > other.sequence;
+        }
+    };
+
+    void reset();
+    // reads one record into its thread's queue, false at the end of the trace
+    bool readAhead();
+    // returns the key of the thread's head
+    size_t pushHead(int thread);
+
+    RecordSource &source_;
+    MergeOrder order_;
+    size_t window_;
+    int thread_count_; // the trace's threads, those not seen yet count as idle
+
+    std::vector<Thread> threads_; // indexed by trace thread
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads_;
+    std::deque<TraceRecord> invalid_; // negative threads, passed on for main to reject
+    size_t idle_threads_;             // threads with nothing pending
+    size_t ahead_key_;                // of the last record read, SIZE_MAX when unknown
+    size_t buffered_, read_, merged_;
+    bool exhausted_;
+    int last_thread_; // its next record joins the heap once it has been charged
+};
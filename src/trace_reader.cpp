@@ -0,0 +1,110 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "trace_reader.h"
+
+bool TraceReader::next(TraceRecord &record)
+{
+    while (std::getline(in_, line_))
+    {
+        line_no_++;
+        // comments and the #eof marker written by the pintool
+        if (line_.empty() || line_[0] == '#')
+            continue;
+        if (!parse(line_.c_str(), record))
+        {
+            std::cerr << "Malformed trace record on line " << line_no_ << ": " << line_ << "\n";
+            exit(1);
+        }
+        return true;
+    }
+    return false;
+}
+
+size_t TraceReader::tell()
+{
+    // at the end of the trace tellg fails until the stream state is cleared
+    std::ios::iostate state = in_.rdstate();
+    in_.clear();
+    std::streampos offset = in_.tellg();
+    in_.setstate(state);
+    return offset < 0 ? 0 : (size_t)offset;
+}
+
+bool TraceReader::seek(size_t offset, size_t line_no)
+{
+    in_.clear();
+    in_.seekg(0, std::ios::end);
+    if (!in_ || (size_t)in_.tellg() < offset)
+        return false;
+    in_.seekg(offset);
+    line_no_ = line_no;
+    return (bool)in_;
+}
+
+bool TraceReader::parse(const char *line, TraceRecord &record)
+{
+    char *end;
+    record.proc = strtol(line, &end, 10);
+    if (end == line)
+        return false;
+
+    line = end;
+    while (*line == ' ' || *line == '\t')
+        line++;
+    record.rw = *line++;
+    if (record.rw != 'R' && record.rw != 'W' && record.rw != 'A')
+        return false;
+
+    record.addr = strtoull(line, &end, 16);
+    if (end == line)
+        return false;
+    line = end;
+
+    record.node_id = strtol(line, &end, 10);
+    if (end == line)
+        return false;
+    line = end;
+
+    record.ip = 0;
+    record.ts = 0;
+    record.ic = 0;
+    record.size = 0;
+    record.count = 1;
+    record.end_node = -1;
+    while (true)
+    {
+        while (*line == ' ' || *line == '\t' || *line == '\r')
+            line++;
+        if (*line == '\0')
+            return true;
+
+        const char *eq = strchr(line, '=');
+        if (eq == nullptr)
+            return false;
+        size_t key_len = eq - line;
+        const char *value = eq + 1;
+        if (key_len == 2 && strncmp(line, "ip", 2) == 0)
+            record.ip = strtoull(value, &end, 16);
+        else if (key_len == 2 && strncmp(line, "ts", 2) == 0)
+            record.ts = strtoull(value, &end, 10);
+        else if (key_len == 2 && strncmp(line, "ic", 2) == 0)
+            record.ic = strtoull(value, &end, 10);
+        else if (key_len == 2 && strncmp(line, "sz", 2) == 0)
+            record.size = strtol(value, &end, 10);
+        else if (key_len == 2 && strncmp(line, "en", 2) == 0)
+            record.end_node = strtol(value, &end, 10);
+        else if (key_len == 1 && *line == 'n')
+        {
+            record.count = strtoull(value, &end, 10);
+            if (record.count == 0)
+                return false;
+        }
+        else
+            end = (char *)strpbrk(value, " \t\r");
+        if (end == nullptr)
+            return true;
+        line = end;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <istream>
+#include <string>
+#include <stddef.h>
+
+// One line of a trace: "<proc> <R|W|A> <addr> <node> [key=value ...]", A is
+// an atomic read-modify-write. The optional fields are tagged so the format
+// can grow without breaking old traces, unknown tags are ignored.
+struct TraceRecord
+{
+    int proc = 0;
+    char rw = 'R';
+    size_t addr = 0;
+    int node_id = 0;
+    size_t ip = 0;     // ip=<hex>, 0 when the tracer did not record it
+    size_t ts = 0;     // ts=<ns>, when the access happened
+    size_t ic = 0;     // ic=<N>, instructions the thread had executed
+    int size = 0;      // sz=<bytes>, 0 when the tracer did not record it
+    size_t count = 1;  // n=<N>, the same access N times in a row by the thread
+    int end_node = -1; // en=<node>, home of the last byte when it is on another page
+};
+
+// where the simulated accesses come from, a trace file or a generator
+class RecordSource
+{
+public:
+    virtual ~RecordSource() {}
+
+    // false at the end of the accesses
+    virtual bool next(TraceRecord &record) = 0;
+    virtual size_t getLineNumber() const = 0;
+
+    // position of the next record, for checkpoints
+    virtual size_t tell() = 0;
+    // continue at a position from tell, false if there are fewer records
+    virtual bool seek(size_t offset, size_t line_no) = 0;
+
+    // sources that order records by simulated time are told the modeled
+    // latency of every record once it has been simulated
+    virtual bool timed() const { return false; }
+    virtual void charge(size_t) {}
+};
+
+class TraceReader : public RecordSource
+{
+public:
+    explicit TraceReader(std::istream &in) : in_(in), line_no_(0) {}
+
+    // exits on a malformed record
+    bool next(TraceRecord &record) override;
+    size_t getLineNumber() const override { return line_no_; }
+
+    // the byte offset of the next record
+    size_t tell() override;
+    bool seek(size_t offset, size_t line_no) override;
+
+private:
+    bool parse(const char *line, TraceRecord &record);
+
+    std::istream &in_;
+    std::string line_;
+    size_t line_no_;
+};
@@ -0,0 +1,152 @@
+#include <iomanip>
+
+#include "traffic_matrix.h"
+
+const char *msgTypeName(MsgType type)
+{
+    switch (type)
+    {
+    case MsgType::BUSRD:
+        return "BUSRD";
+    case MsgType::BUSRDX:
+        return "BUSRDX";
+    case MsgType::EVICTION:
+        return "EVICTION";
+    case MsgType::DATA:
+        return "DATA";
+    case MsgType::BROADCAST:
+        return "BROADCAST";
+    case MsgType::NACK:
+        return "NACK";
+    case MsgType::FETCH:
+        return "FETCH";
+    case MsgType::INVALIDATE:
+        return "INVALIDATE";
+    case MsgType::READDATA:
+        return "READDATA";
+    case MsgType::READDATA_EX:
+        return "READDATA_EX";
+    case MsgType::WRITEDATA:
+        return "WRITEDATA";
+    case MsgType::COUNT:
+        break;
+    }
+    return "UNKNOWN";
+}
+
+MsgType toMsgType(CacheMsg msg)
+{
+    switch (msg)
+    {
+    case CacheMsg::BUSRD:
+        return MsgType::BUSRD;
+    case CacheMsg::BUSRDX:
+        return MsgType::BUSRDX;
+    case CacheMsg::EVICTION:
+        return MsgType::EVICTION;
+    case CacheMsg::DATA:
+        return MsgType::DATA;
+    case CacheMsg::NACK:
+        return MsgType::NACK;
+    case CacheMsg::BROADCAST:
+    case CacheMsg::NOP:
+        break;
+    }
+    return MsgType::BROADCAST;
+}
+
+MsgType toMsgType(DirectoryMsg msg)
+{
+    switch (msg)
+    {
+    case DirectoryMsg::READDATA_EX:
+        return MsgType::READDATA_EX;
+    case DirectoryMsg::READDATA:
+        return MsgType::READDATA;
+    case DirectoryMsg::WRITEDATA:
+        return MsgType::WRITEDATA;
+    case DirectoryMsg::FETCH:
+        return MsgType::FETCH;
+    case DirectoryMsg::INVALIDATE:
+        break;
+    }
+    return MsgType::INVALIDATE;
+}
+
+TrafficMatrix::TrafficMatrix(int nodes, int line_size)
+    : nodes_(nodes),
+      line_size_(line_size),
+      messages_((size_t)nodes * nodes * (size_t)MsgType::COUNT, 0),
+      bytes_((size_t)nodes * nodes * (size_t)MsgType::COUNT, 0) {}
+
+size_t TrafficMatrix::cell(int src, int dst, MsgType type) const
+{
+    return ((size_t)src * nodes_ + dst) * (size_t)MsgType::COUNT + (size_t)type;
+}
+
+void TrafficMatrix::record(int src_node, int dst_node, MsgType type, bool carries_data)
+{
+    size_t i = cell(src_node, dst_node, type);
+    messages_[i] += 1;
+    bytes_[i] += MSG_HEADER_BYTES + (carries_data ? line_size_ : 0);
+}
+
+void TrafficMatrix::writeCsv(std::ostream &out) const
+{
+    out << "src,dst,type,messages,bytes\n";
+    for (int src = 0; src < nodes_; ++src)
+        for (int dst = 0; dst < nodes_; ++dst)
+            for (size_t t = 0; t < (size_t)MsgType::COUNT; ++t)
+            {
+                size_t i = cell(src, dst, (MsgType)t);
+                if (messages_[i] == 0)
+                    continue;
+                out << src << "," << dst << "," << msgTypeName((MsgType)t) << ","
+                    << messages_[i] << "," << bytes_[i] << "\n";
+            }
+    out.flush();
+}
+
+void TrafficMatrix::printSummary(std::ostream &out) const
+{
+    out << "\t** Node To Node Traffic (bytes) ***\n\n"
+        << std::left << std::setw(10) << "src\\dst";
+    for (int dst = 0; dst < nodes_; ++dst)
+        out << std::setw(14) << dst;
+    out << "\n";
+    for (int src = 0; src < nodes_; ++src)
+    {
+        out << std::setw(10) << src;
+        for (int dst = 0; dst < nodes_; ++dst)
+        {
+            size_t total = 0;
+            for (size_t t = 0; t < (size_t)MsgType::COUNT; ++t)
+                total += bytes_[cell(src, dst, (MsgType)t)];
+            out << std::setw(14) << total;
+        }
+        out << "\n";
+    }
+
+    out << "\n"
+        << std::setw(14) << "Type" << std::setw(14) << "Local Msgs" << std::setw(14) << "Global Msgs"
+        << "Global Bytes\n";
+    for (size_t t = 0; t < (size_t)MsgType::COUNT; ++t)
+    {
+        size_t local = 0, global = 0, global_bytes = 0;
+        for (int src = 0; src < nodes_; ++src)
+            for (int dst = 0; dst < nodes_; ++dst)
+            {
+                size_t i = cell(src, dst, (MsgType)t);
+                if (src == dst)
+                    local += messages_[i];
+                else
+                {
+                    global += messages_[i];
+                    global_bytes += bytes_[i];
+                }
+            }
+        out << std::setw(14) << msgTypeName((MsgType)t) << std::setw(14) << local << std::setw(14) << global
+            << global_bytes << "\n";
+    }
+    out << std::right << std::endl;
+}
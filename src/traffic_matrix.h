@@ -0,0 +1,53 @@
+#pragma once
+#include <ostream>
+#include <vector>
+#include <stddef.h>
+
+#include "cache.h"
+
+// control part of every message: type, address and ids
+static const int MSG_HEADER_BYTES = 8;
+
+// message types in the order they are reported
+enum class MsgType
+{
+    BUSRD,
+    BUSRDX,
+    EVICTION,
+    DATA,
+    BROADCAST,
+    NACK,
+    FETCH,
+    INVALIDATE,
+    READDATA,
+    READDATA_EX,
+    WRITEDATA,
+    COUNT
+};
+
+const char *msgTypeName(MsgType type);
+MsgType toMsgType(CacheMsg msg);
+MsgType toMsgType(DirectoryMsg msg);
+
+// Counts messages and estimated bytes for every source node, destination
+// node and message type. Messages that stay inside a node are on the
+// diagonal.
+class TrafficMatrix
+{
+public:
+    TrafficMatrix(int nodes, int line_size);
+
+    void record(int src_node, int dst_node, MsgType type, bool carries_data);
+
+    // long format, one row per non-empty cell: src,dst,type,messages,bytes
+    void writeCsv(std::ostream &out) const;
+    void printSummary(std::ostream &out) const;
+
+private:
+    size_t cell(int src, int dst, MsgType type) const;
+
+    int nodes_;
+    int line_size_;
+    std::vector<size_t> messages_;
+    std::vector<size_t> bytes_;
+};
@@ -0,0 +1,253 @@
+#include <cmath>
+
+#include "workload_gen.h"
+
+// generated lines start at a page aligned base, far from address 0
+static const size_t GEN_BASE_ADDR = 0x10000000;
+// every kind of access gets its own ip so --ip-profile can tell them apart
+static const size_t GEN_IP_READ = 0x401000;
+static const size_t GEN_IP_WRITE = 0x401010;
+static const size_t GEN_IP_SPIN = 0x401020;
+static const size_t GEN_IP_ACQUIRE = 0x401030;
+static const size_t GEN_IP_RELEASE = 0x401040;
+// the lock patterns use two lines, the lock and the counter it protects
+static const size_t LOCK_LINE = 0;
+static const size_t COUNTER_LINE = 1;
+
+const char *patternName(Pattern pattern)
+{
+    switch (pattern)
+    {
+    case Pattern::UNIFORM:
+        return "uniform";
+    case Pattern::ZIPF:
+        return "zipf";
+    case Pattern::PRODUCER_CONSUMER:
+        return "producer-consumer";
+    case Pattern::MIGRATORY:
+        return "migratory";
+    case Pattern::READ_MOSTLY:
+        return "read-mostly";
+    case Pattern::TS_LOCK:
+        return "ts-lock";
+    case Pattern::TICKET_LOCK:
+        return "ticket-lock";
+    }
+    return "unknown";
+}
+
+WorkloadGenerator::WorkloadGenerator(const GeneratorConfig &config)
+    : config_(config),
+      page_bits_(0),
+      zetan_(0),
+      alpha_(0),
+      eta_(0),
+      half_pow_theta_(0),
+      random_(2 * BATCH),
+      batch_(BATCH)
+{
+    while (((size_t)1 << (page_bits_ + 1)) <= config_.page_size)
+        page_bits_ += 1;
+
+    double write_ratio = config_.write_ratio;
+    if (write_ratio < 0)
+        write_ratio = config_.pattern == Pattern::READ_MOSTLY ? 0.02 : 0.3;
+    write_threshold_ = write_ratio >= 1 ? UINT64_MAX : (uint64_t)std::ldexp(write_ratio, 64);
+
+    if (config_.pattern == Pattern::ZIPF)
+    {
+        double theta = config_.zipf_theta;
+        double n = config_.lines;
+        for (size_t i = 1; i <= config_.lines; ++i)
+            zetan_ += 1 / std::pow((double)i, theta);
+        double zeta2 = 1 + std::pow(0.5, theta);
+        alpha_ = 1 / (1 - theta);
+        eta_ = (1 - std::pow(2 / n, 1 - theta)) / (1 - zeta2 / zetan_);
+        half_pow_theta_ = std::pow(0.5, theta);
+    }
+    reset();
+}
+
+void WorkloadGenerator::reset()
+{
+    // splitmix64 spreads consecutive seeds over the lanes
+    uint64_t seed = config_.seed;
+    for (uint64_t &lane : lanes_)
+    {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        lane = (z ^ (z >> 31)) | 1;
+    }
+    batch_size_ = 0;
+    batch_pos_ = 0;
+    produced_ = 0;
+    procs_.assign(config_.procs, ProcState());
+    lock_held_ = false;
+    next_ticket_ = 0;
+    now_serving_ = 0;
+}
+
+bool WorkloadGenerator::seek(size_t offset, size_t)
+{
+    reset();
+    TraceRecord record;
+    while (produced_ < offset)
+        if (!next(record))
+            return false;
+    return true;
+}
+
+bool WorkloadGenerator::next(TraceRecord &record)
+{
+    if (batch_pos_ == batch_size_)
+    {
+        if (produced_ == config_.accesses)
+            return false;
+        refill();
+    }
+    record = batch_[batch_pos_++];
+    produced_ += 1;
+    return true;
+}
+
+void WorkloadGenerator::refill()
+{
+    size_t first = produced_;
+    batch_size_ = std::min(BATCH, config_.accesses - first);
+    batch_pos_ = 0;
+
+    // two randoms per access, the lanes are independent so the loop vectorizes
+    size_t count = 2 * batch_size_;
+    for (size_t i = 0; i < count; i += LANES)
+        for (int lane = 0; lane < LANES; ++lane)
+        {
+            uint64_t x = lanes_[lane];
+            x ^= x >> 12;
+            x ^= x << 25;
+            x ^= x >> 27;
+            lanes_[lane] = x;
+            random_[i + lane] = x * 0x2545f4914f6cdd1dULL;
+        }
+
+    for (size_t i = 0; i < batch_size_; ++i)
+        generate(first + i, random_[2 * i], random_[2 * i + 1], batch_[i]);
+}
+
+size_t WorkloadGenerator::zipf(uint64_t random) const
+{
+    double u = (random >> 11) * 0x1.0p-53;
+    double uz = u * zetan_;
+    if (uz < 1)
+        return 0;
+    if (uz < 1 + half_pow_theta_)
+        return 1;
+    size_t rank = (size_t)(config_.lines * std::pow(eta_ * u - eta_ + 1, alpha_));
+    return std::min(rank, config_.lines - 1);
+}
+
+void WorkloadGenerator::setAccess(TraceRecord &record, int proc, char rw, size_t line, size_t ip) const
+{
+    record.proc = proc;
+    record.rw = rw;
+    record.addr = GEN_BASE_ADDR + (line << config_.offset_len);
+    record.node_id = (record.addr >> page_bits_) % config_.numa_nodes;
+    record.ip = ip;
+}
+
+void WorkloadGenerator::generate(size_t index, uint64_t random, uint64_t write_random, TraceRecord &record)
+{
+    int proc = index % config_.procs;
+    size_t round = index / config_.procs;
+    bool write = write_random < write_threshold_;
+    ProcState &state = procs_[proc];
+
+    switch (config_.pattern)
+    {
+    case Pattern::UNIFORM:
+    case Pattern::READ_MOSTLY:
+        setAccess(record, proc, write ? 'W' : 'R', random % config_.lines, write ? GEN_IP_WRITE : GEN_IP_READ);
+        break;
+    case Pattern::ZIPF:
+        setAccess(record, proc, write ? 'W' : 'R', zipf(random), write ? GEN_IP_WRITE : GEN_IP_READ);
+        break;
+    case Pattern::PRODUCER_CONSUMER:
+    {
+        // even procs fill a ring that the next proc reads in the same round,
+        // a proc without a partner only produces
+        int pairs = (config_.procs + 1) / 2;
+        size_t ring = std::max<size_t>(1, config_.lines / pairs);
+        size_t line = (proc / 2) * ring + round % ring;
+        bool producer = proc % 2 == 0;
+        setAccess(record, proc, producer ? 'W' : 'R', line, producer ? GEN_IP_WRITE : GEN_IP_READ);
+        break;
+    }
+    case Pattern::MIGRATORY:
+    {
+        // every two rounds each line moves on to the previous proc
+        size_t line = (round / 2 + proc) % config_.lines;
+        bool second = round % 2 == 1;
+        setAccess(record, proc, second ? 'W' : 'R', line, second ? GEN_IP_WRITE : GEN_IP_READ);
+        break;
+    }
+    case Pattern::TS_LOCK:
+        switch (state.step)
+        {
+        case 0: // lock(): exchange until it returns false
+            setAccess(record, proc, 'A', LOCK_LINE, lock_held_ ? GEN_IP_SPIN : GEN_IP_ACQUIRE);
+            if (!lock_held_)
+            {
+                lock_held_ = true;
+                state.step = 1;
+            }
+            break;
+        case 1: // counter++
+            setAccess(record, proc, 'R', COUNTER_LINE, GEN_IP_READ);
+            state.step = 2;
+            break;
+        case 2:
+            setAccess(record, proc, 'W', COUNTER_LINE, GEN_IP_WRITE);
+            state.step = 3;
+            break;
+        default: // unlock()
+            setAccess(record, proc, 'W', LOCK_LINE, GEN_IP_RELEASE);
+            lock_held_ = false;
+            state.step = 0;
+            break;
+        }
+        break;
+    case Pattern::TICKET_LOCK:
+        // current and next_ticket share the lock line like in the program
+        switch (state.step)
+        {
+        case 0: // next_ticket.fetch_add(1)
+            setAccess(record, proc, 'A', LOCK_LINE, GEN_IP_ACQUIRE);
+            state.ticket = next_ticket_++;
+            state.step = 1;
+            break;
+        case 1: // while (current.load() != my_ticket)
+            setAccess(record, proc, 'R', LOCK_LINE, GEN_IP_SPIN);
+            if (now_serving_ == state.ticket)
+                state.step = 2;
+            break;
+        case 2: // counter++
+            setAccess(record, proc, 'R', COUNTER_LINE, GEN_IP_READ);
+            state.step = 3;
+            break;
+        case 3:
+            setAccess(record, proc, 'W', COUNTER_LINE, GEN_IP_WRITE);
+            state.step = 4;
+            break;
+        case 4: // current.store(current.load() + 1)
+            setAccess(record, proc, 'R', LOCK_LINE, GEN_IP_RELEASE);
+            state.step = 5;
+            break;
+        default:
+            setAccess(record, proc, 'W', LOCK_LINE, GEN_IP_RELEASE);
+            now_serving_ += 1;
+            state.step = 0;
+            break;
+        }
+        break;
+    }
+}
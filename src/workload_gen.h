@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <stddef.h>
+
+#include "trace_reader.h"
+
+// synthetic access patterns, each one a classic sharing behaviour
+enum class Pattern
+{
+    UNIFORM,           // every proc reads and writes random shared lines
+    ZIPF,              // like uniform, a few hot lines take most accesses
+    PRODUCER_CONSUMER, // proc pairs, one writes a buffer the other reads
+    MIGRATORY,         // lines are read and then written by one proc after another
+    READ_MOSTLY,       // random shared lines, rarely written
+    TS_LOCK,           // programs/ts_lock.cpp: waiters spin with exchange
+    TICKET_LOCK        // programs/ticketlock.cpp: waiters spin reading the ticket
+};
+
+const char *patternName(Pattern pattern);
+
+struct GeneratorConfig
+{
+    Pattern pattern = Pattern::UNIFORM;
+    int procs = 1;
+    int numa_nodes = 1;
+    int offset_len = 6;
+    size_t page_size = 4096; // pages are interleaved over the nodes
+    size_t accesses = 1000000;
+    size_t lines = 4096;      // shared footprint, unused by the locks
+    double write_ratio = -1;  // < 0 takes the pattern's default
+    double zipf_theta = 0.99; // in [0, 1)
+    uint64_t seed = 1;
+};
+
+// Generates accesses on the fly in place of a trace. Procs take turns like in
+// a round robin trace and the same seed always gives the same accesses, which
+// is also how a checkpoint position is found again.
+class WorkloadGenerator : public RecordSource
+{
+public:
+    explicit WorkloadGenerator(const GeneratorConfig &config);
+
+    bool next(TraceRecord &record) override;
+    size_t tell() override { return produced_; }
+    // regenerates and drops offset accesses
+    bool seek(size_t offset, size_t line_no) override;
+    size_t getLineNumber() const override { return produced_; }
+
+private:
+    static constexpr size_t BATCH = 4096;
+    static constexpr int LANES = 8;
+
+    struct ProcState
+    {
+        int step = 0;
+        size_t ticket = 0;
+    };
+
+    void reset();
+    void refill();
+    void generate(size_t index, uint64_t random, uint64_t write_random, TraceRecord &record);
+    size_t zipf(uint64_t random) const;
+    void setAccess(TraceRecord &record, int proc, char rw, size_t line, size_t ip) const;
+
+    GeneratorConfig config_;
+    int page_bits_;
+    uint64_t write_threshold_; // a random value below it writes
+
+    // zipf constants after Gray et al., "Quickly generating billion-record
+    // synthetic databases"
+    double zetan_, alpha_, eta_, half_pow_theta_;
+
+    // independent xorshift lanes, one batch of randoms per refill
+    uint64_t lanes_[LANES];
+    std::vector<uint64_t> random_;
+    std::vector<TraceRecord> batch_;
+    size_t batch_size_, batch_pos_;
+    size_t produced_;
+
+    // the lock patterns are sequential, every proc runs a small state machine
+    std::vector<ProcState> procs_;
+    bool lock_held_;
+    size_t next_ticket_, now_serving_;
+};
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""Compare two bench.out json results and flag throughput regressions.
+
+usage: bench-compare.py <baseline.json> <current.json> [--threshold 0.05]
+
+Exits with status 1 if any benchmark in both files got slower by more than
+the threshold (a fraction of the baseline throughput).
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, mode="r") as f:
+        return {b["name"]: b["ops_per_sec"] for b in json.load(f)["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="allowed slowdown as a fraction, default 0.05")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = []
+    print(f"{'benchmark':40}{'baseline':>14}{'current':>14}{'change':>10}")
+    for name, ops in current.items():
+        if name not in baseline:
+            print(f"{name:40}{'-':>14}{ops:>14.0f}{'new':>10}")
+            continue
+        change = ops / baseline[name] - 1
+        flag = ""
+        if change < -args.threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        print(f"{name:40}{baseline[name]:>14.0f}{ops:>14.0f}{change:>+10.1%}{flag}")
+    for name in baseline:
+        if name not in current:
+            print(f"{name:40}{baseline[name]:>14.0f}{'-':>14}{'missing':>10}")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) regressed by more than "
+              f"{args.threshold:.0%}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Check that --merge ts restores the recorded order of a shuffled trace.
+
+usage: check-merge.py [--sim ./sim.out] [--records 20000]
+
+Writes a trace whose records reach the file out of ts= order, as when the
+tracer's threads get its lock late, and the same records sorted by ts=.
+Threads also start at different times, so a thread's first record can come
+after later records of the others. The merged run of the shuffled trace has
+to print the same stats as a plain run of the sorted one. Exits with status
+1 if they differ.
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+THREADS = 4
+NODES = 2
+
+
+def make_records(count, seed):
+    rng = random.Random(seed)
+    records = []
+    # the thread in the low digits keeps every ts unique, ties could merge
+    # either way. Every thread starts later than the one before it.
+    clocks = [100 + 2000 * t for t in range(THREADS)]
+    for i in range(count):
+        thread = rng.randrange(THREADS)
+        clocks[thread] += rng.randrange(1, 20)
+        line = rng.randrange(4)
+        rw = "W" if rng.random() < 0.5 else "R"
+        records.append((clocks[thread] * THREADS + thread, thread, rw, 0x10000 + 64 * line, line % NODES))
+    return records
+
+
+def shuffle(records, seed):
+    """Delays every record by a random amount, keeping program order per thread."""
+    rng = random.Random(seed)
+    written = []
+    last = [0] * THREADS
+    for ts, thread, rw, addr, node in records:
+        # a record cannot be written before the previous one of its thread
+        last[thread] = max(last[thread], ts + rng.randrange(2000))
+        written.append((last[thread], ts, thread, rw, addr, node))
+    written.sort(key=lambda r: r[0])
+    return [r[1:] for r in written]
+
+
+def write(path, records):
+    with open(path, mode="w") as f:
+        for ts, thread, rw, addr, node in records:
+            f.write("%d %s %#x %d ts=%d\n" % (thread, rw, addr, node, ts))
+
+
+def stats(sim, trace, merge):
+    cmd = [sim, "-t", trace, "-p", str(THREADS), "-n", str(NODES), "-f", "json"]
+    if merge:
+        cmd += ["--merge", "ts"]
+    result = json.loads(subprocess.run(cmd, check=True, capture_output=True, text=True).stdout)
+    return {key: result[key] for key in ("aggregate", "aggregate_skip0", "nodes")}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--sim", default="./sim.out")
+    parser.add_argument("--records", type=int, default=20000)
+    args = parser.parse_args()
+
+    records = make_records(args.records, 1)
+    by_ts = sorted(records, key=lambda r: r[0])
+    with tempfile.TemporaryDirectory() as tmp:
+        shuffled_path = os.path.join(tmp, "shuffled.trace")
+        sorted_path = os.path.join(tmp, "sorted.trace")
+        write(shuffled_path, shuffle(records, 2))
+        write(sorted_path, by_ts)
+        merged = stats(args.sim, shuffled_path, True)
+        ordered = stats(args.sim, sorted_path, False)
+
+    if merged != ordered:
+        print("--merge ts of the shuffled trace differs from the sorted trace", file=sys.stderr)
+        sys.exit(1)
+    print("--merge ts matches the sorted trace")
+
+
+if __name__ == "__main__":
+    main()
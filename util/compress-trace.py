@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Fold back to back repeats of an access in a trace into one n=<N> record.
+
+usage: compress-trace.py <trace> [-o <out>]
+
+Records are repeats if they only differ in ts= and ic=, the run keeps those
+of its first access. Traces written by pinatrace with rl=1 are already
+folded, this is for older ones and other tracers.
+"""
+
+import argparse
+import sys
+
+# fields that change with every repeat and do not make a new access
+PER_ACCESS = ("ts=", "ic=")
+
+
+def split(line):
+    """The access without its per-access fields and its repeat count."""
+    fields = line.split()
+    count = 1
+    key = []
+    for field in fields:
+        if field.startswith("n="):
+            count = int(field[2:])
+        elif not field.startswith(PER_ACCESS):
+            key.append(field)
+    return tuple(key), count
+
+
+def write(out, line, count):
+    fields = [f for f in line.split() if not f.startswith("n=")]
+    if count > 1:
+        fields.append("n=%d" % count)
+    out.write(" ".join(fields) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("trace")
+    parser.add_argument("-o", "--output", help="default is stdout")
+    args = parser.parse_args()
+
+    out = open(args.output, mode="w") if args.output else sys.stdout
+    records = runs = 0
+    first, key, count = None, None, 0
+    with open(args.trace, mode="r") as f:
+        for line in f:
+            if line.startswith("#") or not line.strip():
+                if first is not None:
+                    write(out, first, count)
+                    first = None
+                out.write(line)
+                continue
+            records += 1
+            line_key, line_count = split(line)
+            if first is not None and line_key == key:
+                count += line_count
+                continue
+            if first is not None:
+                write(out, first, count)
+            runs += 1
+            first, key, count = line, line_key, line_count
+    if first is not None:
+        write(out, first, count)
+
+    if out is not sys.stdout:
+        out.close()
+    print("%d records folded into %d" % (records, runs), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -33,6 +33,27 @@ PIN_LOCK lock;
 
 KNOB<std::string> KnobOutputFile(KNOB_MODE_WRITEONCE, "pintool", "o", "pinatrace.out",
                                  "specify output file name");
+KNOB<BOOL> KnobRecordIP(KNOB_MODE_WRITEONCE, "pintool", "ip", "1",
+                        "append the instruction pointer to every record as ip=<addr>");
+KNOB<BOOL> KnobRecordTime(KNOB_MODE_WRITEONCE, "pintool", "ts", "1",
+                          "append the time of every access in ns as ts=<N>");
+KNOB<BOOL> KnobRecordIcount(KNOB_MODE_WRITEONCE, "pintool", "ic", "1",
+                            "append the instructions the thread has executed as ic=<N>");
+KNOB<BOOL> KnobRecordSize(KNOB_MODE_WRITEONCE, "pintool", "sz", "1",
+                          "append the bytes of every access as sz=<N>");
+KNOB<BOOL> KnobRunLength(KNOB_MODE_WRITEONCE, "pintool", "rl", "1",
+                         "write back to back repeats of an access as one record with n=<N>");
+
+// instructions executed per thread, counted a basic block at a time so an
+// access sees the count up to the end of its block. Every thread only writes
+// its own counter, padded to a line so they do not falsely share.
+const int MAX_THREADS = 1024;
+struct ThreadCount
+{
+  UINT64 count;
+  UINT8 pad[56];
+};
+ThreadCount icount[MAX_THREADS];
 
 // it seems like pin compiles this with an older version of gcc so unordered_map
 // hasn't been added yet, but this is an experimental version of it
@@ -123,22 +144,89 @@ int getNumaNode(VOID *addr)
   }
 }
 
-// Print a memory read record
-VOID RecordMemRead(VOID *ip, VOID *addr)
+VOID CountInstructions(THREADID tid, UINT32 instructions)
 {
-  PIN_GetLock(&lock, 0);
-  fprintf(trace, "%d R %p %d\n", PIN_ThreadId(), addr, getNumaNode(addr));
-  PIN_ReleaseLock(&lock);
+  if (tid < MAX_THREADS)
+    icount[tid].count += instructions;
 }
 
-// Print a memory write record
-VOID RecordMemWrite(VOID *ip, VOID *addr)
+// the last access, held back while the same thread repeats it exactly, as in
+// a spin loop. ts= and ic= are those of its first access.
+struct Record
+{
+  THREADID tid;
+  char rw;
+  VOID *ip, *addr;
+  UINT32 size;
+  UINT64 ts, ic, count;
+};
+Record pending;
+
+// Print a record as "<thread> <R|W|A> <addr> <node> [ip=<addr>] [ts=<N>] [ic=<N>] [sz=<N>] [en=<node>] [n=<N>]",
+// en= is the node of the last byte when the access crosses into another page
+VOID WriteRecord(const Record &record)
+{
+  fprintf(trace, "%d %c %p %d", record.tid, record.rw, record.addr, getNumaNode(record.addr));
+  if (KnobRecordIP.Value())
+    fprintf(trace, " ip=%p", record.ip);
+  if (KnobRecordTime.Value())
+    fprintf(trace, " ts=%llu", (unsigned long long)record.ts);
+  if (KnobRecordIcount.Value())
+    fprintf(trace, " ic=%llu", (unsigned long long)record.ic);
+  if (KnobRecordSize.Value())
+    fprintf(trace, " sz=%u", record.size);
+  unsigned long first = (unsigned long)record.addr;
+  if (record.size > 1 && first / pagesize != (first + record.size - 1) / pagesize)
+    fprintf(trace, " en=%d", getNumaNode((VOID *)(first + record.size - 1)));
+  if (record.count > 1)
+    fprintf(trace, " n=%llu", (unsigned long long)record.count);
+  fputc('\n', trace);
+}
+
+VOID RecordMemAccess(char rw, VOID *ip, VOID *addr, UINT32 size)
 {
+  // taken before the lock: records are written in the order threads get the
+  // lock, the simulator can restore the order of the accesses from ts=
+  struct timespec now;
+  if (KnobRecordTime.Value())
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  THREADID tid = PIN_ThreadId();
+
   PIN_GetLock(&lock, 0);
-  fprintf(trace, "%d W %p %d\n", PIN_ThreadId(), addr, getNumaNode(addr));
+  if (pending.count > 0 && pending.tid == tid && pending.rw == rw && pending.ip == ip && pending.addr == addr &&
+      pending.size == size)
+  {
+    pending.count++;
+    PIN_ReleaseLock(&lock);
+    return;
+  }
+  if (pending.count > 0)
+    WriteRecord(pending);
+  pending.tid = tid;
+  pending.rw = rw;
+  pending.ip = ip;
+  pending.addr = addr;
+  pending.size = size;
+  pending.ts = KnobRecordTime.Value() ? (UINT64)now.tv_sec * 1000000000ULL + now.tv_nsec : 0;
+  pending.ic = tid < MAX_THREADS ? icount[tid].count : 0;
+  pending.count = 1;
+  if (!KnobRunLength.Value())
+  {
+    WriteRecord(pending);
+    pending.count = 0;
+  }
   PIN_ReleaseLock(&lock);
 }
 
+// Print a memory read record
+VOID RecordMemRead(VOID *ip, VOID *addr, UINT32 size) { RecordMemAccess('R', ip, addr, size); }
+
+// Print a memory write record
+VOID RecordMemWrite(VOID *ip, VOID *addr, UINT32 size) { RecordMemAccess('W', ip, addr, size); }
+
+// Print an atomic read-modify-write record
+VOID RecordMemAtomic(VOID *ip, VOID *addr, UINT32 size) { RecordMemAccess('A', ip, addr, size); }
+
 // Is called for every instruction and instruments reads and writes
 VOID Instruction(INS ins, VOID *v)
 {
@@ -146,16 +234,26 @@ VOID Instruction(INS ins, VOID *v)
   // the instrumentation is called iff the instruction will actually be executed.
   //
   // On the IA-32 and Intel(R) 64 architectures conditional moves and REP
-  // prefixed instructions appear as predicated instructions in Pin.
+  // prefixed instructions appear as predicated instructions in Pin, so a rep
+  // movs is recorded once per iteration with the size of one element.
   uint32_t memOperands = INS_MemoryOperandCount(ins);
 
   // Iterate over each memory operand of the instruction.
   for (uint32_t memOp = 0; memOp < memOperands; memOp++)
   {
+    // a locked instruction (lock add, xchg, cmpxchg) reads and writes its
+    // operand as one atomic access, the simulator takes the line exclusively
+    // once instead of reading it and upgrading it for the write
+    if (INS_IsAtomicUpdate(ins) && INS_MemoryOperandIsRead(ins, memOp) && INS_MemoryOperandIsWritten(ins, memOp))
+    {
+      INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)RecordMemAtomic, IARG_INST_PTR,
+                               IARG_MEMORYOP_EA, memOp, IARG_MEMORYOP_SIZE, memOp, IARG_END);
+      continue;
+    }
     if (INS_MemoryOperandIsRead(ins, memOp))
     {
       INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)RecordMemRead, IARG_INST_PTR,
-                               IARG_MEMORYOP_EA, memOp, IARG_END);
+                               IARG_MEMORYOP_EA, memOp, IARG_MEMORYOP_SIZE, memOp, IARG_END);
     }
     // Note that in some architectures a single memory operand can be
     // both read and written (for instance incl (%eax) on IA-32)
@@ -163,13 +261,25 @@ VOID Instruction(INS ins, VOID *v)
     if (INS_MemoryOperandIsWritten(ins, memOp))
     {
       INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)RecordMemWrite, IARG_INST_PTR,
-                               IARG_MEMORYOP_EA, memOp, IARG_END);
+                               IARG_MEMORYOP_EA, memOp, IARG_MEMORYOP_SIZE, memOp, IARG_END);
     }
   }
 }
 
+// Is called for every trace and counts the instructions of its basic blocks
+VOID Trace(TRACE pin_trace, VOID *v)
+{
+  for (BBL bbl = TRACE_BblHead(pin_trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+  {
+    BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)CountInstructions, IARG_THREAD_ID, IARG_UINT32,
+                   BBL_NumIns(bbl), IARG_END);
+  }
+}
+
 VOID Fini(INT32 code, VOID *v)
 {
+  if (pending.count > 0)
+    WriteRecord(pending);
   fprintf(trace, "#eof\n");
   fclose(trace);
 }
@@ -200,6 +310,8 @@ int main(int argc, char *argv[])
   trace = fopen(KnobOutputFile.Value().c_str(), "w");
 
   INS_AddInstrumentFunction(Instruction, 0);
+  if (KnobRecordIcount.Value())
+    TRACE_AddInstrumentFunction(Trace, 0);
   PIN_AddFiniFunction(Fini, 0);
 
   // Never returns
@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 
+import json
 import matplotlib.pyplot as plt
 import os
 from parse import parse
@@ -46,59 +47,44 @@ def pp_metric(metric: str):
 
 class TraceData:
     def __init__(self, direc, f):
-        parse_res = parse(direc + "_{}_{}.txt", f)
+        parse_res = parse(direc + "_{}_{}.json", f)
         self.lock_type = direc
         self.nprocs = int(parse_res[0])
         self.protocol = parse_res[1]
 
-        file = open(f"../results/{direc}/{f}", mode="r")
-        lines = file.readlines()
-        file.close()
-
-        self.total_ops = int(parse("Total Reads/Writes:\t\t{}\n", lines[7])[0])
-
-        self.total_hits = int(parse("Total Hits:\t\t{}\n", lines[11])[0])
-        self.total_misses = int(parse("Total Misses:\t\t{}\n", lines[12])[0])
-        # self.total_flushes = int(parse("Total Flushes:\t\t{}\n", lines[13])[0])
-        # self.total_evict = int(parse("Total Evictions: \t{}\n", lines[14])[0])
-        # self.total_devict = int(
-        #     parse("Total Dirty Evictions: \t{}\n", lines[15])[0])
-        self.total_invalid = int(
-            parse("Total Invalidations: \t{}\n", lines[16])[0])
-
-        self.total_local = int(
-            parse("Total Local Events: \t{}\n", lines[20])[0])
-        self.total_global = int(
-            parse("Total Global Events: \t{}\n", lines[21])[0])
-
-        self.total_mem = int(parse("Total Memory Reads: \t{}\n", lines[25])[0])
-
-        self.cache_time = self.parse_time("Cache Access Latency:\t\t{}",
-                                          lines[29])
-        self.mem_read_time = self.parse_time("Memory Read Latency:\t\t{}",
-                                             lines[30])
-        self.mem_write_time = self.parse_time("Memory Write Latency:\t\t{}",
-                                              lines[31])
-        self.mem_access_time = self.parse_time("Memory Access Latency:\t\t{}",
-                                               lines[32])
-        self.inter_local_time = self.parse_time("Local Events Latency:\t{}",
-                                                lines[33])
-        self.inter_global_time = self.parse_time("Global Events Latency:\t{}",
-                                                 lines[34])
+        with open(f"../results/{direc}/{f}", mode="r") as file:
+            results = json.load(file)
+
+        # the lock benchmarks' main thread only spawns workers, so use the
+        # stats without processor 0
+        stats = results["aggregate_skip0"]
+        latencies = stats["latencies_ns"]
+
+        self.total_ops = stats["total_events"]
+
+        self.total_hits = stats["hits"]
+        self.total_misses = stats["misses"]
+        # self.total_flushes = stats["flushes"]
+        # self.total_evict = stats["evictions"]
+        # self.total_devict = stats["dirty_evictions"]
+        self.total_invalid = stats["invalidations"]
+
+        self.total_local = stats["local_events"]
+        self.total_global = stats["global_events"]
+
+        self.total_mem = stats["memory_reads"]
+
+        # times are kept in us
+        self.cache_time = latencies["cache_access"] / 1000
+        self.mem_read_time = latencies["memory_read"] / 1000
+        self.mem_write_time = latencies["memory_write"] / 1000
+        self.mem_access_time = self.mem_read_time + self.mem_write_time
+        self.inter_local_time = latencies["local_events"] / 1000
+        self.inter_global_time = latencies["global_events"] / 1000
 
         self.total_time = (self.cache_time + self.mem_access_time +
                            self.inter_local_time + self.inter_global_time)
 
-    def parse_time(self, form, line):
-        try_ms = parse(form + "ms\n", line)
-        try_ns = parse(form + "ns\n", line)
-        if try_ms is not None:
-            return int(try_ms[0]) * 1000
-        elif try_ns is not None:
-            return int(try_ns[0]) / 1000
-        else:
-            return int(parse(form + "us\n", line)[0])
-
     def get(self, field):
         return self.__dict__[field]
 
@@ -163,8 +149,9 @@ def compare_protocols_bar(metric, normalize=True):
                         y.append(trace.get(metric) / trace.total_ops)
                     else:
                         y.append(trace.get(metric))
-            # sort in order MSI, MOESI
-            x, y = unzip(sorted(list(zip(x, y)), key=lambda v: len(v[0])))
+            # sort in the order of the protocols list
+            x, y = unzip(
+                sorted(list(zip(x, y)), key=lambda v: protocols.index(v[0])))
 
             plt.bar(x, y, align="center")
             prettyMetric = pp_metric(metric)
@@ -181,31 +168,23 @@ def compare_protocols_bar(metric, normalize=True):
 
 def compare_protocols_and_nprocs(metric):
     for lock in lock_types:
-        msi_x = []
-        msi_y = []
-        moesi_x = []
-        moesi_y = []
-        for trace in all_traces:
-            if trace.lock_type == lock:
-                if trace.protocol == "MSI":
-                    msi_y.append(trace.get(metric))
-                    msi_x.append(trace.nprocs)
-                else:  # trace.protocol == 'MOESI'
-                    moesi_y.append(trace.get(metric))
-                    moesi_x.append(trace.nprocs)
-        # sort by nprocs
-        msi_x, msi_y = unzip(
-            sorted(list(zip(msi_x, msi_y)), key=lambda v: v[0]))
-        moesi_x, moesi_y = unzip(
-            sorted(list(zip(moesi_x, moesi_y)), key=lambda v: v[0]))
-
-        # use ms for total time
-        if metric == "total_time":
-            msi_y = list(map(lambda x: x / 1000, msi_y))
-            moesi_y = list(map(lambda x: x / 1000, moesi_y))
+        for protocol in protocols:
+            x = []
+            y = []
+            for trace in all_traces:
+                if trace.lock_type == lock and trace.protocol == protocol:
+                    y.append(trace.get(metric))
+                    x.append(trace.nprocs)
+            if not x:
+                continue
+            # sort by nprocs
+            x, y = unzip(sorted(list(zip(x, y)), key=lambda v: v[0]))
+
+            # use ms for total time
+            if metric == "total_time":
+                y = list(map(lambda v: v / 1000, y))
 
-        plt.plot(msi_x, msi_y, label="msi", marker=".")
-        plt.plot(moesi_x, moesi_y, label="moesi", marker=".")
+            plt.plot(x, y, label=protocol.lower(), marker=".")
         plt.legend()
         prettyMetric = pp_metric(metric)
         plt.title(f"{prettyMetric} vs Number of Procs, {lock}")
@@ -287,9 +266,10 @@ def plot_all():
             compare_protocols_and_nprocs(metric)
 
 
-protocols = ["MSI", "MOESI"]
+protocols = ["MSI", "MESI", "MESIF", "MOESI"]
 lock_types = [
-    "arraylock", "arraylock_aligned", "ticketlock", "tts_lock", "ts_lock"
+    "arraylock", "arraylock_aligned", "ticketlock", "tts_lock", "ts_lock",
+    "mcs_lock", "clh_lock", "hclh_lock", "cohort_lock", "numa_rwlock"
 ]
 nprocs = [2, 4, 8, 16, 32]
 all_traces = []
@@ -3,8 +3,14 @@ workdir="/home/yxchen/Projects/CSE240/NUMA-Cache-Sim"
 cd $workdir
 make
 
-progs=(ts_lock tts_lock ticketlock arraylock arraylock_aligned)
-protocols=(MSI MOESI)
+progs=(ts_lock tts_lock ticketlock arraylock arraylock_aligned mcs_lock clh_lock hclh_lock cohort_lock numa_rwlock)
+protocols=(MSI MESI MESIF MOESI)
+
+# simulated NUMA nodes, one per thread unless NODES is set, use the same
+# value the traces were generated with
+numa_nodes () {
+    echo ${NODES:-$threads}
+}
 
 # run msi, mesi and moesi sims on given prog name
 run_one_sim () {
@@ -12,7 +18,7 @@ run_one_sim () {
     mkdir -p "$workdir/results/$prog"
     for protocol in ${protocols[@]}; do
         echo "Running sim on $prog with protocol $protocol and $threads threads"
-        $workdir/sim.out -t $workdir/traces/${prog}${threads}.trace -p ${threads} -n ${threads} -m ${protocol} -A -i > $workdir/results/${prog}/${prog}_${threads}_${protocol}.txt
+        $workdir/sim.out -t $workdir/traces/${prog}${threads}.trace -p ${threads} -n $(numa_nodes) -m ${protocol} --format json -o $workdir/results/${prog}/${prog}_${threads}_${protocol}.json
     done
 }
 
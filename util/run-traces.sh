@@ -8,8 +8,25 @@ make
 cd $pin_path/source/tools/ManualExamples
 make
 
-progs=(ts_lock tts_lock ticketlock arraylock arraylock_aligned)
-protocols=(MSI MOESI)
+progs=(ts_lock tts_lock ticketlock arraylock arraylock_aligned mcs_lock clh_lock hclh_lock cohort_lock numa_rwlock)
+protocols=(MSI MESI MESIF MOESI)
+# lock acquisitions per thread and counter increments per critical section,
+# only the queue and NUMA-aware locks take them
+iterations=100
+cs_length=10
+
+# simulated NUMA nodes, one per thread unless NODES is set
+numa_nodes () {
+    echo ${NODES:-$threads}
+}
+
+# arguments after the thread count
+prog_args () {
+    case $1 in
+        mcs_lock|clh_lock) echo "$iterations $cs_length" ;;
+        hclh_lock|cohort_lock|numa_rwlock) echo "$(numa_nodes) $iterations $cs_length" ;;
+    esac
+}
 
 generate_traces () {
     cd $pin_path/source/tools/ManualExamples
@@ -17,7 +34,7 @@ generate_traces () {
     for prog in ${progs[@]}; do
         echo "Generating trace for ${prog} with ${threads} threads"
         outfile=$cachesim_path/traces/${prog}${threads}.trace
-        ../../../pin -t obj-intel64/pinatrace.so -o $outfile -- $cachesim_path/programs/${prog}.out ${threads}
+        ../../../pin -t obj-intel64/pinatrace.so -o $outfile -- $cachesim_path/programs/${prog}.out ${threads} $(prog_args $prog)
 
         # check that the file ends in the eof str
         eof_str=$(tail -n 1 $outfile)